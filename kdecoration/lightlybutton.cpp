@@ -24,9 +24,10 @@
 #include <KColorUtils>
 #include <KIconLoader>
 
+#include <QCache>
 #include <QPainter>
-#include <QVariantAnimation>
 #include <QPainterPath>
+#include <QtMath>
 
 namespace Lightly
 {
@@ -35,22 +36,97 @@ namespace Lightly
     using KDecoration2::ColorGroup;
     using KDecoration2::DecorationButtonType;
 
+    namespace
+    {
+        //* everything a button glyph depends on
+        struct GlyphKey
+        {
+            int type;
+            bool checked;
+            qreal width;
+            qreal height;
+            QRgb color;
+            qreal devicePixelRatio;
+
+            bool operator==(const GlyphKey &other) const
+            {
+                return type == other.type
+                    && checked == other.checked
+                    && width == other.width
+                    && height == other.height
+                    && color == other.color
+                    && devicePixelRatio == other.devicePixelRatio;
+            }
+        };
+
+        inline uint qHash(const GlyphKey &key, uint seed = 0)
+        {
+            seed = ::qHash(key.type, seed);
+            seed = ::qHash(key.checked, seed);
+            seed = ::qHash(key.width, seed);
+            seed = ::qHash(key.height, seed);
+            seed = ::qHash(key.color, seed);
+            return ::qHash(key.devicePixelRatio, seed);
+        }
+
+        //* rendered glyphs, shared by all buttons of all decorations
+        using GlyphCache = QCache<GlyphKey, QPixmap>;
+        Q_GLOBAL_STATIC_WITH_ARGS(GlyphCache, s_glyphCache, (128))
+
+        //* render a button glyph, centered in a rect of given size at the origin
+        void renderGlyph(QPainter *painter, DecorationButtonType type, bool checked, const QSizeF &size, const QColor &color)
+        {
+            // setup painter
+            painter->translate(size.width() / 2, size.height() / 2);
+            painter->scale(size.height() * 0.17, size.height() * 0.17);
+            QPen pen(color);
+            pen.setCapStyle(Qt::RoundCap);
+            pen.setJoinStyle(Qt::RoundJoin);
+            pen.setWidthF(PenWidth::Symbol / size.height() * 8.0);
+
+            painter->setPen(pen);
+            painter->setBrush(Qt::NoBrush);
+
+            switch (type) {
+
+                case DecorationButtonType::Close:
+                    painter->drawLine(QPointF(-1, -1), QPointF(1, 1));
+                    painter->drawLine(QPointF(1, -1), QPointF(-1, 1));
+                    break;
+
+                case DecorationButtonType::Maximize:
+                    if (checked) {
+                        painter->drawRoundedRect(QRectF(-1, -0.5, 1.5, 1.5), 0.3, 0.3);
+                        painter->setClipRect(QRectF(-0.45, -1, 1.45, 1.45), Qt::ReplaceClip);
+                        painter->drawRoundedRect(QRectF(-1, -1, 2.0, 2.0), 0.5, 0.5);
+                        painter->setClipRect(QRectF(0, 0, 0, 0), Qt::NoClip);
+                    } else {
+                        painter->drawRoundedRect(QRectF(-1, -1, 2, 2), 0.3, 0.3);
+                    }
+                    break;
+
+                case DecorationButtonType::Minimize:
+                    painter->drawLine(QPointF(-1, 0), QPointF(1, 0));
+                    break;
+
+                case DecorationButtonType::ApplicationMenu:
+                    painter->drawLine(QPointF(-1, -1), QPointF(1, -1));
+                    painter->drawLine(QPointF(-1, 0), QPointF(1, 0));
+                    painter->drawLine(QPointF(-1, 1), QPointF(1, 1));
+                    break;
+
+                // TODO: the rest of the buttons
+                default: break;
+            }
+        }
+    }
+
 
     //__________________________________________________________________
     Button::Button(DecorationButtonType type, Decoration* decoration, QObject* parent)
         : DecorationButton(type, decoration, parent)
-        , m_animation( new QVariantAnimation( this ) )
     {
 
-        // setup animation
-        // It is important start and end value are of the same type, hence 0.0 and not just 0
-        m_animation->setStartValue( 0.0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-        connect(m_animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
-            setOpacity(value.toReal());
-        });
-
         // setup default geometry
         const int height = decoration->buttonHeight();
         setGeometry(QRect(0, 0, height, height));
@@ -58,7 +134,11 @@ namespace Lightly
 
         // connections
         connect(decoration->client().data(), SIGNAL(iconChanged(QIcon)), this, SLOT(update()));
-        connect(decoration->settings().data(), &KDecoration2::DecorationSettings::reconfigured, this, &Button::reconfigure);
+        connect(decoration->settings().data(), &KDecoration2::DecorationSettings::reconfigured, this, [this]() {
+            // colors and button sizes may have changed
+            s_glyphCache->clear();
+            reconfigure();
+        });
         connect( this, &KDecoration2::DecorationButton::hoveredChanged, this, &Button::updateAnimationState );
 
         reconfigure();
@@ -110,7 +190,7 @@ namespace Lightly
                 break;
 
                 case DecorationButtonType::Menu:
-                QObject::connect(d->client().data(), &KDecoration2::DecoratedClient::iconChanged, b, [b]() { b->update(); });
+                QObject::connect(d->client().data(), &KDecoration2::DecoratedClient::iconChanged, b, [b]() { b->m_menuIcon = QPixmap(); b->update(); });
                 break;
 
                 default: break;
@@ -127,10 +207,11 @@ namespace Lightly
     //__________________________________________________________________
     void Button::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        Q_UNUSED(repaintRegion)
-
         if (!decoration()) return;
 
+        // buttons outside of the repaint region are left alone
+        if (!geometry().toAlignedRect().intersects(repaintRegion)) return;
+
         painter->save();
 
         if( !m_iconSize.isValid() ) m_iconSize = geometry().size().toSize();
@@ -192,16 +273,41 @@ namespace Lightly
 
             const QRectF iconRect(geometry().topLeft() + m_offset, m_iconSize);
             if (auto deco =  qobject_cast<Decoration*>(decoration())) {
-                const QPalette activePalette = KIconLoader::global()->customPalette();
-                QPalette palette = decoration()->client().data()->palette();
-                palette.setColor(QPalette::Foreground, deco->fontColor());
-                KIconLoader::global()->setCustomPalette(palette);
-                decoration()->client().data()->icon().paint(painter, iconRect.toRect());
-                if (activePalette == QPalette()) {
-                    KIconLoader::global()->resetPalette();
-                }    else {
+                // recoloring the icon means swapping the global icon loader palette,
+                // so it is only done when the icon, its color or its size changed
+                const QIcon icon(decoration()->client().data()->icon());
+                const QColor fontColor(deco->fontColor());
+                const qreal devicePixelRatio(painter->device() ? painter->device()->devicePixelRatioF() : 1.0);
+                if (m_menuIcon.isNull()
+                    || m_menuIconKey != icon.cacheKey()
+                    || m_menuIconColor != fontColor.rgba()
+                    || m_menuIcon.size() != iconRect.toRect().size() * devicePixelRatio
+                    || m_menuIcon.devicePixelRatio() != devicePixelRatio) {
+
+                    m_menuIcon = QPixmap(iconRect.toRect().size() * devicePixelRatio);
+                    m_menuIcon.setDevicePixelRatio(devicePixelRatio);
+                    m_menuIcon.fill(Qt::transparent);
+
+                    const QPalette activePalette = KIconLoader::global()->customPalette();
+                    QPalette palette = decoration()->client().data()->palette();
+                    palette.setColor(QPalette::Foreground, fontColor);
                     KIconLoader::global()->setCustomPalette(palette);
+
+                    QPainter iconPainter(&m_menuIcon);
+                    icon.paint(&iconPainter, QRect(QPoint(0, 0), iconRect.toRect().size()));
+                    iconPainter.end();
+
+                    if (activePalette == QPalette()) {
+                        KIconLoader::global()->resetPalette();
+                    } else {
+                        KIconLoader::global()->setCustomPalette(activePalette);
+                    }
+
+                    m_menuIconKey = icon.cacheKey();
+                    m_menuIconColor = fontColor.rgba();
                 }
+
+                painter->drawPixmap(iconRect.toRect().topLeft(), m_menuIcon);
             } else {
                 decoration()->client().data()->icon().paint(painter, iconRect.toRect());
             }
@@ -210,47 +316,43 @@ namespace Lightly
 
             const QColor foregroundColor(this->foregroundColor());
             if (foregroundColor.isValid()) {
-                // setup painter
-                painter->translate(geometry().center());
-                painter->scale(height * 0.17, height * 0.17);
-                QPen pen(foregroundColor);
-                pen.setCapStyle(Qt::RoundCap);
-                pen.setJoinStyle(Qt::RoundJoin);
-                pen.setWidthF(PenWidth::Symbol / height * 8.0);
-
-                painter->setPen(pen);
-                painter->setBrush(Qt::NoBrush);
-
-                switch (type()) {
-
-                    case DecorationButtonType::Close:
-                        painter->drawLine(QPointF(-1, -1), QPointF(1, 1));
-                        painter->drawLine(QPointF(1, -1), QPointF(-1, 1));
-                        break;
-
-                    case DecorationButtonType::Maximize:
-                        if (isChecked()) {
-                            painter->drawRoundedRect(QRectF(-1, -0.5, 1.5, 1.5), 0.3, 0.3);
-                            painter->setClipRect(QRectF(-0.45, -1, 1.45, 1.45), Qt::ReplaceClip);
-                            painter->drawRoundedRect(QRectF(-1, -1, 2.0, 2.0), 0.5, 0.5);
-                            painter->setClipRect(QRectF(0, 0, 0, 0), Qt::NoClip);
-                        } else {
-                            painter->drawRoundedRect(QRectF(-1, -1, 2, 2), 0.3, 0.3);
-                        }
-                        break;
-
-                    case DecorationButtonType::Minimize:
-                        painter->drawLine(QPointF(-1, 0), QPointF(1, 0));
-                        break;
-
-                    case DecorationButtonType::ApplicationMenu:
-                        painter->drawLine(QPointF(-1, -1), QPointF(1, -1));
-                        painter->drawLine(QPointF(-1, 0), QPointF(1, 0));
-                        painter->drawLine(QPointF(-1, 1), QPointF(1, 1));
-                        break;
-
-                    // TODO: the rest of the buttons
+                const bool checked(type() == DecorationButtonType::Maximize && isChecked());
+                if (d->isAnimated()) {
+                    // the foreground color changes on every frame of the active state fade,
+                    // so the glyph is stroked directly rather than filling the cache
+                    painter->save();
+                    painter->translate(geometry().topLeft());
+                    renderGlyph(painter, type(), checked, QSizeF(width, height), foregroundColor);
+                    painter->restore();
+                    return;
+                }
+
+                // glyphs are shared by all buttons of the same type, size and steady state color
+                const GlyphKey key = {
+                    static_cast<int>(type()),
+                    checked,
+                    width,
+                    height,
+                    foregroundColor.rgba(),
+                    painter->device() ? painter->device()->devicePixelRatioF() : 1.0
+                };
+
+                QPixmap *glyph = s_glyphCache->object(key);
+                if (!glyph) {
+                    glyph = new QPixmap(qCeil(width * key.devicePixelRatio), qCeil(height * key.devicePixelRatio));
+                    glyph->setDevicePixelRatio(key.devicePixelRatio);
+                    glyph->fill(Qt::transparent);
+
+                    QPainter glyphPainter(glyph);
+                    glyphPainter.setRenderHints(QPainter::Antialiasing);
+                    renderGlyph(&glyphPainter, type(), key.checked, QSizeF(width, height), foregroundColor);
+                    glyphPainter.end();
+
+                    s_glyphCache->insert(key, glyph);
                 }
+
+                // pixel aligned, so that the pre-rendered glyph is not resampled
+                painter->drawPixmap(geometry().topLeft().toPoint(), *glyph);
             }
         }
     }
@@ -276,7 +378,7 @@ namespace Lightly
         if (type() == DecorationButtonType::Close) {
             if (isPressed()) {
                 return c->color(ColorGroup::Warning, ColorRole::Foreground).lighter();
-            } else if (m_animation->state() == QAbstractAnimation::Running) {
+            } else if (m_animation.isRunning()) {
                 QColor color(c->color(ColorGroup::Warning, ColorRole::Foreground));
                 color.setAlpha(color.alpha() * m_opacity);
                 return color;
@@ -294,7 +396,7 @@ namespace Lightly
             ) {
             color.setAlpha(64);
             return color;
-        } else if (m_animation->state() == QAbstractAnimation::Running) {
+        } else if (m_animation.isRunning()) {
             color.setAlpha(32 * m_opacity);
             return color;
         } else if (isHovered()) {
@@ -311,7 +413,7 @@ namespace Lightly
 
         // animation
         auto d = qobject_cast<Decoration*>(decoration());
-        if( d )  m_animation->setDuration( d->internalSettings()->animationsDuration() );
+        if( d )  m_animation.setDuration( d->internalSettings()->animationsDuration() );
 
     }
 
@@ -322,8 +424,7 @@ namespace Lightly
         auto d = qobject_cast<Decoration*>(decoration());
         if( !(d && d->internalSettings()->animationsEnabled() ) ) return;
 
-        m_animation->setDirection( hovered ? QAbstractAnimation::Forward : QAbstractAnimation::Backward );
-        if( m_animation->state() != QAbstractAnimation::Running ) m_animation->start();
+        m_animation.start( hovered, [this]( qreal value ) { setOpacity( value ); } );
 
     }
 
@@ -26,8 +26,7 @@
 
 #include <QHash>
 #include <QImage>
-
-class QVariantAnimation;
+#include <QPixmap>
 
 namespace Lightly
 {
@@ -121,7 +120,7 @@ namespace Lightly
         Flag m_flag = FlagNone;
 
         //* active state change animation
-        QVariantAnimation *m_animation;
+        Transition m_animation;
 
         //* vertical offset (for rendering)
         QPointF m_offset;
@@ -131,6 +130,13 @@ namespace Lightly
 
         //* active state change opacity
         qreal m_opacity = 0;
+
+        //*@name recolored application icon, for the menu button
+        //@{
+        mutable QPixmap m_menuIcon;
+        mutable qint64 m_menuIconKey = 0;
+        mutable QRgb m_menuIconColor = 0;
+        //@}
     };
 
 } // namespace
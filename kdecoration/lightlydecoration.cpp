@@ -41,11 +41,11 @@
 #include <KColorUtils>
 #include <KSharedConfig>
 #include <KPluginFactory>
+#include <KWindowInfo>
 
+#include <QHash>
 #include <QPainter>
 #include <QTextStream>
-#include <QTimer>
-#include <QVariantAnimation>
 
 #if LIGHTLY_HAVE_X11
 #include <QX11Info>
@@ -151,31 +151,84 @@ namespace Lightly
     using KDecoration2::ColorGroup;
 
     //________________________________________________________________
-    static int g_sDecoCount = 0;
-    static int g_shadowSizeEnum = InternalSettings::ShadowLarge;
-    static int g_shadowStrength = 255;
-    static QColor g_shadowColor = Qt::black;
-    static QSharedPointer<KDecoration2::DecorationShadow> g_sShadow;
+    //* parts of a radius x radius square that lie outside of a rounded corner, one per corner
+    struct CornerMasks
+    {
+        QRegion topLeft;
+        QRegion topRight;
+        QRegion bottomLeft;
+        QRegion bottomRight;
+    };
 
-    //________________________________________________________________
-    Decoration::Decoration(QObject *parent, const QVariantList &args)
-        : KDecoration2::Decoration(parent, args)
-        , m_animation( new QVariantAnimation( this ) )
+    static const CornerMasks &cornerMasks( int radius )
     {
-        g_sDecoCount++;
+        static QHash<int, CornerMasks> cache;
+
+        auto iter = cache.find( radius );
+        if( iter == cache.end() )
+        {
+
+            // same polygon based rasterization as a full window sized rounded rect, restricted to a circle
+            QPainterPath path;
+            path.addRoundedRect( QRect( 0, 0, 2*radius, 2*radius ), radius, radius );
+            const QRegion circle( path.toFillPolygon().toPolygon() );
+
+            const auto mask = [&]( int x, int y )
+            {
+                const QRect square( x, y, radius, radius );
+                return ( QRegion( square ) - circle ).translated( -x, -y );
+            };
+
+            CornerMasks masks;
+            masks.topLeft = mask( 0, 0 );
+            masks.topRight = mask( radius, 0 );
+            masks.bottomLeft = mask( 0, radius );
+            masks.bottomRight = mask( radius, radius );
+            iter = cache.insert( radius, masks );
+
+        }
+
+        return iter.value();
     }
 
     //________________________________________________________________
-    Decoration::~Decoration()
+    //* everything a decoration shadow depends on
+    struct ShadowKey
     {
-        g_sDecoCount--;
-        if (g_sDecoCount == 0) {
-            // last deco destroyed, clean up shadow
-            g_sShadow.clear();
+        int shadowSize;
+        int shadowStrength;
+        QRgb shadowColor;
+        int windowCornerRadius;
+
+        bool operator==(const ShadowKey &other) const
+        {
+            return shadowSize == other.shadowSize
+                && shadowStrength == other.shadowStrength
+                && shadowColor == other.shadowColor
+                && windowCornerRadius == other.windowCornerRadius;
         }
+    };
 
-        deleteSizeGrip();
+    static inline uint qHash(const ShadowKey &key, uint seed = 0)
+    {
+        seed = ::qHash(key.shadowSize, seed);
+        seed = ::qHash(key.shadowStrength, seed);
+        seed = ::qHash(key.shadowColor, seed);
+        return ::qHash(key.windowCornerRadius, seed);
+    }
+
+    //* shadows shared by all decorations with the same settings, freed once no decoration uses them anymore
+    static QHash<ShadowKey, QWeakPointer<KDecoration2::DecorationShadow>> g_shadowCache;
+
+    //________________________________________________________________
+    Decoration::Decoration(QObject *parent, const QVariantList &args)
+        : KDecoration2::Decoration(parent, args)
+    {}
 
+    //________________________________________________________________
+    Decoration::~Decoration()
+    {
+        deleteSizeGrip();
     }
 
     //________________________________________________________________
@@ -194,7 +247,7 @@ namespace Lightly
 
         auto c = client().data();
         if( hideTitleBar() ) return c->color( ColorGroup::Inactive, ColorRole::TitleBar );
-        else if( m_animation->state() == QAbstractAnimation::Running )
+        else if( m_animation.isRunning() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::TitleBar ),
@@ -210,7 +263,7 @@ namespace Lightly
 
         auto c( client().data() );
         if( !m_internalSettings->drawTitleBarSeparator() ) return QColor();
-        if( m_animation->state() == QAbstractAnimation::Running )
+        if( m_animation.isRunning() )
         {
             QColor color( c->palette().color( QPalette::Highlight ) );
             color.setAlpha( color.alpha()*m_opacity );
@@ -224,7 +277,7 @@ namespace Lightly
     {
 
         auto c = client().data();
-        if( m_animation->state() == QAbstractAnimation::Running )
+        if( m_animation.isRunning() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::Foreground ),
@@ -239,41 +292,33 @@ namespace Lightly
     {
         auto c = client().data();
 
-        // active state change animation
-        // It is important start and end value are of the same type, hence 0.0 and not just 0
-        m_animation->setStartValue( 0.0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-        connect(m_animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
-            setOpacity(value.toReal());
-        });
-
         reconfigure();
-        updateTitleBar();
         auto s = settings();
-        connect(s.data(), &KDecoration2::DecorationSettings::borderSizeChanged, this, &Decoration::recalculateBorders);
-        connect(s.data(), &KDecoration2::DecorationSettings::borderSizeChanged, this, &Decoration::updateBlur); // for the case when a border with transparency
+
+        // layout
+        // signals only mark what became stale, it is all recomputed at once in updateLayout
+        const auto layoutBorders = [this]() { scheduleLayout( LayoutBorders ); };
+        connect(s.data(), &KDecoration2::DecorationSettings::borderSizeChanged, this, layoutBorders);
 
         // a change in font might cause the borders to change
-        connect(s.data(), &KDecoration2::DecorationSettings::fontChanged, this, &Decoration::recalculateBorders);
-        connect(s.data(), &KDecoration2::DecorationSettings::fontChanged, this, &Decoration::updateBlur); // for the case when a border with transparency
-        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, &Decoration::recalculateBorders);
-        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, &Decoration::updateBlur); // for the case when a border with transparency
+        connect(s.data(), &KDecoration2::DecorationSettings::fontChanged, this, layoutBorders);
+        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, layoutBorders);
 
         // buttons
-        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, &Decoration::updateButtonsGeometryDelayed);
-        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsLeftChanged, this, &Decoration::updateButtonsGeometryDelayed);
-        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsRightChanged, this, &Decoration::updateButtonsGeometryDelayed);
+        const auto layoutButtons = [this]() { scheduleLayout( LayoutButtons ); };
+        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsLeftChanged, this, layoutButtons);
+        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsRightChanged, this, layoutButtons);
 
         // full reconfiguration
-        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::reconfigure);
+        // settings provider must be reloaded before any decoration picks its settings from it
         connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, SettingsProvider::self(), &SettingsProvider::reconfigure, Qt::UniqueConnection );
-        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::updateButtonsGeometryDelayed);
+        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::reconfigure);
+        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, layoutButtons);
 
-        connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::recalculateBorders);
-        connect(c, &KDecoration2::DecoratedClient::maximizedHorizontallyChanged, this, &Decoration::recalculateBorders);
-        connect(c, &KDecoration2::DecoratedClient::maximizedVerticallyChanged, this, &Decoration::recalculateBorders);
-        connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::recalculateBorders);
+        connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, layoutBorders);
+        connect(c, &KDecoration2::DecoratedClient::maximizedHorizontallyChanged, this, layoutBorders);
+        connect(c, &KDecoration2::DecoratedClient::maximizedVerticallyChanged, this, layoutBorders);
+        connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, [this]() { scheduleLayout( LayoutBorders|LayoutSizeGrip ); });
         connect(c, &KDecoration2::DecoratedClient::captionChanged, this,
             [this]()
             {
@@ -283,18 +328,16 @@ namespace Lightly
         );
 
         connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::updateAnimationState);
-        connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::updateBlur);
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateTitleBar);
-        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateTitleBar);
-        connect(c, &KDecoration2::DecoratedClient::sizeChanged, this, &Decoration::updateBlur);
-
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateButtonsGeometry);
+        connect(c, &KDecoration2::DecoratedClient::activeChanged, this, [this]() { scheduleLayout( LayoutBlur ); });
+        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, [this]() { scheduleLayout( LayoutTitleBar|LayoutButtons ); });
+        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, [this]() { scheduleLayout( LayoutTitleBar|LayoutButtons|LayoutSizeGrip ); });
+        connect(c, &KDecoration2::DecoratedClient::sizeChanged, this, [this]() { scheduleLayout( LayoutBlur ); });
 
         createButtons();
         createShadow();
+
+        // the first layout is done right away, so that the decoration is complete once initialized
+        updateLayout();
     }
 
     //________________________________________________________________
@@ -317,8 +360,7 @@ namespace Lightly
         {
 
             auto c = client().data();
-            m_animation->setDirection( c->isActive() ? QAbstractAnimation::Forward : QAbstractAnimation::Backward );
-            if( m_animation->state() != QAbstractAnimation::Running ) m_animation->start();
+            m_animation.start( c->isActive(), [this]( qreal value ) { setOpacity( value ); } );
 
         } else {
 
@@ -379,14 +421,18 @@ namespace Lightly
     void Decoration::reconfigure()
     {
 
-        m_internalSettings = SettingsProvider::self()->internalSettings( this );
+        const InternalSettingsPtr internalSettings( SettingsProvider::self()->internalSettings( this ) );
+
+        // nothing to update when the settings of this decoration did not change
+        const bool changed( !SettingsProvider::isEquivalent( m_internalSettings, internalSettings ) );
+        m_internalSettings = internalSettings;
+        if( !changed ) return;
 
         // animation
-        m_animation->setDuration( m_internalSettings->animationsDuration() );
+        m_animation.setDuration( m_internalSettings->animationsDuration() );
 
         // borders
-        recalculateBorders();
-        updateBlur();
+        scheduleLayout( LayoutBorders );
 
         // shadow
         createShadow();
@@ -397,16 +443,55 @@ namespace Lightly
 
     }
 
+    //________________________________________________________________
+    void Decoration::scheduleLayout( int flags )
+    {
+        if( !m_dirtyLayout ) QMetaObject::invokeMethod( this, &Decoration::updateLayout, Qt::QueuedConnection );
+        m_dirtyLayout |= flags;
+    }
+
+    //________________________________________________________________
+    void Decoration::updateLayout()
+    {
+        int flags( m_dirtyLayout );
+        m_dirtyLayout = 0;
+        if( !flags ) return;
+
+        // borders move the title bar, the buttons and the blurred area
+        if( flags & LayoutBorders )
+        {
+            recalculateBorders();
+            flags |= LayoutTitleBar|LayoutButtons|LayoutBlur;
+        }
+
+        if( flags & LayoutTitleBar ) updateTitleBar();
+        if( flags & LayoutButtons ) updateButtonsGeometry();
+        if( flags & LayoutBlur ) updateBlur();
+        if( flags & LayoutSizeGrip ) updateSizeGripVisibility();
+    }
+
     void Decoration::updateBlur()
     {
         auto s = settings();
 
-        QPainterPath windowPath;
-        if (s->isAlphaChannelSupported() && !isMaximized())
-            windowPath.addRoundedRect(rect(), m_internalSettings->windowCornerRadius(), m_internalSettings->windowCornerRadius());
-        else
-            windowPath.addRect(rect());
-        setBlurRegion(QRegion(windowPath.toFillPolygon().toPolygon()));
+        const QRect rect( this->rect() );
+        const int radius( qMin( m_internalSettings->windowCornerRadius(), qMin( rect.width(), rect.height() )/2 ) );
+
+        QRegion region( rect );
+        if( s->isAlphaChannelSupported() && !isMaximized() && radius > 0 )
+        {
+            // cut the rounded corners away, using regions computed once per radius
+            const CornerMasks &masks( cornerMasks( radius ) );
+            region -= masks.topLeft.translated( rect.topLeft() );
+            region -= masks.topRight.translated( rect.right() + 1 - radius, rect.top() );
+            region -= masks.bottomLeft.translated( rect.left(), rect.bottom() + 1 - radius );
+            region -= masks.bottomRight.translated( rect.right() + 1 - radius, rect.bottom() + 1 - radius );
+        }
+
+        // blur region changes are not free on the compositor side
+        if( region == m_blurRegion ) return;
+        m_blurRegion = region;
+        setBlurRegion( region );
     }
 
     //________________________________________________________________
@@ -449,10 +534,6 @@ namespace Lightly
         updateButtonsGeometry();
     }
 
-    //________________________________________________________________
-    void Decoration::updateButtonsGeometryDelayed()
-    { QTimer::singleShot( 0, this, &Decoration::updateButtonsGeometry ); }
-
     //________________________________________________________________
     void Decoration::updateButtonsGeometry()
     {
@@ -501,21 +582,28 @@ namespace Lightly
     //________________________________________________________________
     void Decoration::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        // TODO: optimize based on repaintRegion
         auto c = client().data();
         auto s = settings();
 
+        const QRect paintRect( repaintRegion & rect() );
+        if( paintRect.isEmpty() ) return;
+
+        // nothing outside of the repaint region needs to be touched
+        painter->save();
+        painter->setClipRect( paintRect, Qt::IntersectClip );
+
         // paint background
-        if( !c->isShaded() )
+        const QRect frameRect( hideTitleBar() ? rect() : rect().adjusted( 0, borderTop(), 0, 0 ) );
+        if( !c->isShaded() && frameRect.intersects( paintRect ) )
         {
-            painter->fillRect(rect(), Qt::transparent);
+            painter->fillRect(paintRect, Qt::transparent);
             painter->save();
             painter->setRenderHint(QPainter::Antialiasing);
             painter->setPen(Qt::NoPen);
             painter->setBrush( c->color( c->isActive() ? ColorGroup::Active : ColorGroup::Inactive, ColorRole::Frame ) );
 
             // clip away the top part
-            if( !hideTitleBar() ) painter->setClipRect(0, borderTop(), size().width(), size().height() - borderTop(), Qt::IntersectClip);
+            if( !hideTitleBar() ) painter->setClipRect(frameRect, Qt::IntersectClip);
 
             if (s->isAlphaChannelSupported()) painter->drawRoundedRect(rect(), m_internalSettings->windowCornerRadius(), m_internalSettings->windowCornerRadius());
             else painter->drawRect( rect() );
@@ -523,9 +611,10 @@ namespace Lightly
             painter->restore();
         }
 
-        if( !hideTitleBar() ) paintTitleBar(painter, repaintRegion);
+        if( !hideTitleBar() ) paintTitleBar(painter, paintRect);
 
-        if( hasBorders() && !s->isAlphaChannelSupported() )
+        // the outline is only one pixel wide, skip it when the repaint region lies inside
+        if( hasBorders() && !s->isAlphaChannelSupported() && !rect().adjusted( 1, 1, -1, -1 ).contains( paintRect ) )
         {
             painter->save();
             painter->setRenderHint(QPainter::Antialiasing, false);
@@ -538,6 +627,8 @@ namespace Lightly
             painter->restore();
         }
 
+        painter->restore();
+
     }
 
     //________________________________________________________________
@@ -548,6 +639,83 @@ namespace Lightly
 
         if ( !titleRect.intersects(repaintRegion) ) return;
 
+        auto s = settings();
+
+        // the background only changes on resize, palette and setting changes, so it is cached;
+        // while the active state is animated it changes every frame and is painted directly
+        if( m_animation.isRunning() ) renderTitleBarBackground( painter, titleRect );
+        else {
+
+            const QColor outlineColor( this->outlineColor() );
+            const TitleBarCacheKey key = {
+                titleRect.size(),
+                painter->device() ? painter->device()->devicePixelRatioF() : 1.0,
+                c->isActive() && m_internalSettings->drawBackgroundGradient(),
+                titleBarColor().rgba(),
+                outlineColor.isValid() ? outlineColor.rgba() : 0,
+                m_internalSettings->windowCornerRadius(),
+                isMaximized(),
+                c->isShaded(),
+                s->isAlphaChannelSupported(),
+                isLeftEdge(),
+                isTopEdge(),
+                isRightEdge(),
+                static_cast<int>(painter->renderHints())
+            };
+
+            if( m_titleBarCache.isNull() || !(m_titleBarCacheKey == key) )
+            {
+                m_titleBarCache = QPixmap( titleRect.size()*key.devicePixelRatio );
+                m_titleBarCache.setDevicePixelRatio( key.devicePixelRatio );
+                m_titleBarCache.fill( Qt::transparent );
+
+                QPainter cachePainter( &m_titleBarCache );
+                cachePainter.setRenderHints( painter->renderHints() );
+                renderTitleBarBackground( &cachePainter, titleRect );
+                cachePainter.end();
+
+                m_titleBarCacheKey = key;
+            }
+
+            painter->drawPixmap( titleRect.topLeft(), m_titleBarCache );
+
+        }
+
+        // draw caption
+        const auto cR = captionRect();
+        if( cR.first.intersects( repaintRegion ) )
+        {
+            painter->setFont(s->font());
+            painter->setPen( fontColor() );
+
+            // elide and lay out the caption only when it, the font, or the available width changed
+            if( m_captionLayout.elidedWidth != cR.first.width() || m_captionLayout.caption != c->caption() || m_captionLayout.font != s->font() )
+            {
+                updateCaptionLayout();
+                m_captionLayout.elidedWidth = cR.first.width();
+                m_captionLayout.staticText.setTextFormat( Qt::PlainText );
+                m_captionLayout.staticText.setText( painter->fontMetrics().elidedText(c->caption(), Qt::ElideMiddle, cR.first.width()) );
+                m_captionLayout.staticText.prepare( QTransform(), s->font() );
+            }
+
+            const QSizeF textSize( m_captionLayout.staticText.size() );
+            QPointF position( cR.first.left(), cR.first.top() + ( cR.first.height() - textSize.height() )/2 );
+            if( cR.second & Qt::AlignRight ) position.setX( cR.first.left() + cR.first.width() - textSize.width() );
+            else if( cR.second & Qt::AlignHCenter ) position.setX( cR.first.left() + ( cR.first.width() - textSize.width() )/2 );
+
+            painter->drawStaticText( position, m_captionLayout.staticText );
+        }
+
+        // draw all buttons
+        m_leftButtons->paint(painter, repaintRegion);
+        m_rightButtons->paint(painter, repaintRegion);
+    }
+
+    //________________________________________________________________
+    void Decoration::renderTitleBarBackground(QPainter *painter, const QRect &titleRect) const
+    {
+        const auto c = client().data();
+
         painter->save();
         painter->setPen(Qt::NoPen);
 
@@ -629,16 +797,6 @@ namespace Lightly
 
         painter->restore();
 
-        // draw caption
-        painter->setFont(s->font());
-        painter->setPen( fontColor() );
-        const auto cR = captionRect();
-        const QString caption = painter->fontMetrics().elidedText(c->caption(), Qt::ElideMiddle, cR.first.width());
-        painter->drawText(cR.first, cR.second | Qt::TextSingleLine, caption);
-
-        // draw all buttons
-        m_leftButtons->paint(painter, repaintRegion);
-        m_rightButtons->paint(painter, repaintRegion);
     }
 
     //________________________________________________________________
@@ -656,6 +814,23 @@ namespace Lightly
 
     }
 
+    //________________________________________________________________
+    QString Decoration::windowClass() const
+    {
+        if( m_windowClass.isNull() )
+        {
+            auto c = client().data();
+
+            // the window may not be mapped yet, in which case it is fetched again next time
+            if( c->windowId() == 0 ) return QStringLiteral(" ");
+
+            KWindowInfo info( c->windowId(), nullptr, NET::WM2WindowClass );
+            m_windowClass = QString::fromUtf8(info.windowClassName()) + QStringLiteral(" ") + QString::fromUtf8(info.windowClassClass());
+        }
+
+        return m_windowClass;
+    }
+
     //________________________________________________________________
     int Decoration::captionHeight() const
     { return hideTitleBar() ? borderTop() : borderTop() - settings()->smallSpacing()*(Metrics::TitleBar_BottomMargin + Metrics::TitleBar_TopMargin ) - 1; }
@@ -695,7 +870,8 @@ namespace Lightly
 
                     // full caption rect
                     const QRect fullRect = QRect( 0, yOffset, size().width(), captionHeight() );
-                    QRect boundingRect( settings()->fontMetrics().boundingRect( c->caption()).toRect() );
+                    updateCaptionLayout();
+                    QRect boundingRect( m_captionLayout.boundingRect );
 
                     // text bounding rect
                     boundingRect.setTop( yOffset );
@@ -714,90 +890,126 @@ namespace Lightly
 
     }
 
+    //________________________________________________________________
+    void Decoration::updateCaptionLayout() const
+    {
+        auto c = client().data();
+        auto s = settings();
+        if( m_captionLayout.caption == c->caption() && m_captionLayout.font == s->font() ) return;
+
+        m_captionLayout.caption = c->caption();
+        m_captionLayout.font = s->font();
+        m_captionLayout.boundingRect = s->fontMetrics().boundingRect( m_captionLayout.caption ).toRect();
+
+        // force the elided text to be recomputed
+        m_captionLayout.elidedWidth = -1;
+    }
+
     //________________________________________________________________
     void Decoration::createShadow()
     {
-        if (!g_sShadow
-                ||g_shadowSizeEnum != m_internalSettings->shadowSize()
-                || g_shadowStrength != m_internalSettings->shadowStrength()
-                || g_shadowColor != m_internalSettings->shadowColor())
+        const ShadowKey key = {
+            m_internalSettings->shadowSize(),
+            m_internalSettings->shadowStrength(),
+            m_internalSettings->shadowColor().rgba(),
+            m_internalSettings->windowCornerRadius()
+        };
+
+        QSharedPointer<KDecoration2::DecorationShadow> shadow = g_shadowCache.value(key).toStrongRef();
+        if( !shadow )
         {
-            g_shadowSizeEnum = m_internalSettings->shadowSize();
-            g_shadowStrength = m_internalSettings->shadowStrength();
-            g_shadowColor = m_internalSettings->shadowColor();
-
-            const CompositeShadowParams params = lookupShadowParams(g_shadowSizeEnum);
-            if (params.isNone()) {
-                g_sShadow.clear();
-                setShadow(g_sShadow);
-                return;
+            // drop entries no decoration uses anymore
+            for( auto it = g_shadowCache.begin(); it != g_shadowCache.end(); )
+            {
+                if( it.value().isNull() ) it = g_shadowCache.erase( it );
+                else ++it;
             }
 
-            auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
-                QColor c(color);
-                c.setAlphaF(opacity);
-                return c;
-            };
+            shadow = renderShadow( key.shadowSize, key.shadowStrength, QColor::fromRgba( key.shadowColor ), key.windowCornerRadius );
+            if( shadow ) g_shadowCache.insert( key, shadow );
+        }
 
-            const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
-                .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
-
-            BoxShadowRenderer shadowRenderer;
-            shadowRenderer.setBorderRadius(m_internalSettings->windowCornerRadius() + 0.5);
-            shadowRenderer.setBoxSize(boxSize);
-            shadowRenderer.setDevicePixelRatio(1.0); // TODO: Create HiDPI shadows?
-
-            const qreal strength = static_cast<qreal>(g_shadowStrength) / 255.0;
-            shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
-                withOpacity(g_shadowColor, params.shadow1.opacity * strength));
-            shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
-                withOpacity(g_shadowColor, params.shadow2.opacity * strength));
-
-            QImage shadowTexture = shadowRenderer.render();
-
-            QPainter painter(&shadowTexture);
-            painter.setRenderHint(QPainter::Antialiasing);
-
-            const QRect outerRect = shadowTexture.rect();
-
-            QRect boxRect(QPoint(0, 0), boxSize);
-            boxRect.moveCenter(outerRect.center());
-
-            const QMargins padding = QMargins(
-                boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
-                boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
-                outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
-                outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
-            const QRect innerRect = outerRect - padding;
-
-            // Draw outline.
-            painter.setPen(withOpacity(g_shadowColor, 0.4 * strength));
-            painter.setBrush(Qt::NoBrush);
-            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-            painter.drawRoundedRect(
-                innerRect,
-                m_internalSettings->windowCornerRadius() - 0.5,
-                m_internalSettings->windowCornerRadius() - 0.5);
-
-            // Mask out inner rect.
-            painter.setPen(Qt::NoPen);
-            painter.setBrush(Qt::black);
-            painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-            painter.drawRoundedRect(
-                innerRect,
-                m_internalSettings->windowCornerRadius() + 0.5,
-                m_internalSettings->windowCornerRadius() + 0.5);
-
-
-            painter.end();
-
-            g_sShadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
-            g_sShadow->setPadding(padding);
-            g_sShadow->setInnerShadowRect(QRect(outerRect.center(), QSize(1, 1)));
-            g_sShadow->setShadow(shadowTexture);
+        setShadow(shadow);
+    }
+
+    //________________________________________________________________
+    QSharedPointer<KDecoration2::DecorationShadow> Decoration::renderShadow(int shadowSize, int shadowStrength, const QColor &shadowColor, int windowCornerRadius)
+    {
+        const CompositeShadowParams params = lookupShadowParams(shadowSize);
+        if (params.isNone()) {
+            return {};
         }
 
-        setShadow(g_sShadow);
+        auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
+            QColor c(color);
+            c.setAlphaF(opacity);
+            return c;
+        };
+
+        const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
+            .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
+
+        BoxShadowRenderer shadowRenderer;
+        shadowRenderer.setBorderRadius(windowCornerRadius + 0.5);
+        shadowRenderer.setBoxSize(boxSize);
+        shadowRenderer.setDevicePixelRatio(1.0); // TODO: Create HiDPI shadows?
+        shadowRenderer.setPersistentCacheEnabled(true);
+
+        const qreal strength = static_cast<qreal>(shadowStrength) / 255.0;
+        shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
+            withOpacity(shadowColor, params.shadow1.opacity * strength));
+        shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
+            withOpacity(shadowColor, params.shadow2.opacity * strength));
+
+        // The inner rect is outlined and masked out below, offset from the box.
+        const QMargins frameMargins(
+            Metrics::Shadow_Overlap + params.offset.x(),
+            Metrics::Shadow_Overlap + params.offset.y(),
+            Metrics::Shadow_Overlap - params.offset.x(),
+            Metrics::Shadow_Overlap - params.offset.y());
+
+        const BoxShadowRenderer::Tiles tiles = shadowRenderer.renderTiles(frameMargins);
+        QImage shadowTexture = tiles.image;
+
+        QPainter painter(&shadowTexture);
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        const QRect outerRect = shadowTexture.rect();
+        const QRect &boxRect = tiles.boxRect;
+
+        const QMargins padding = QMargins(
+            boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
+            boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
+            outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
+            outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
+        const QRect innerRect = outerRect - padding;
+
+        // Draw outline.
+        painter.setPen(withOpacity(shadowColor, 0.4 * strength));
+        painter.setBrush(Qt::NoBrush);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.drawRoundedRect(
+            innerRect,
+            windowCornerRadius - 0.5,
+            windowCornerRadius - 0.5);
+
+        // Mask out inner rect.
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
+        painter.drawRoundedRect(
+            innerRect,
+            windowCornerRadius + 0.5,
+            windowCornerRadius + 0.5);
+
+
+        painter.end();
+
+        auto shadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
+        shadow->setPadding(padding);
+        shadow->setInnerShadowRect(QRect(outerRect.center(), QSize(1, 1)));
+        shadow->setShadow(shadowTexture);
+        return shadow;
     }
 
     //_________________________________________________________________
@@ -817,9 +1029,7 @@ namespace Lightly
         if( c->windowId() != 0 )
         {
             m_sizeGrip = new SizeGrip( this );
-            connect( c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateSizeGripVisibility );
-            connect( c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateSizeGripVisibility );
-            connect( c, &KDecoration2::DecoratedClient::resizeableChanged, this, &Decoration::updateSizeGripVisibility );
+            connect( c, &KDecoration2::DecoratedClient::resizeableChanged, this, [this]() { scheduleLayout( LayoutSizeGrip ); } );
         }
         #endif
 
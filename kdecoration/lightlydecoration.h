@@ -24,6 +24,7 @@
 
 #include "lightly.h"
 #include "lightlysettings.h"
+#include "lightlytransition.h"
 
 #include <KDecoration2/Decoration>
 #include <KDecoration2/DecoratedClient>
@@ -31,14 +32,17 @@
 
 #include <QPainterPath>
 #include <QPalette>
+#include <QPixmap>
+#include <QRegion>
+#include <QSharedPointer>
+#include <QStaticText>
 #include <QVariant>
 
-class QVariantAnimation;
-
 namespace KDecoration2
 {
     class DecorationButton;
     class DecorationButtonGroup;
+    class DecorationShadow;
 }
 
 namespace Lightly
@@ -69,6 +73,9 @@ namespace Lightly
         //* button height
         int buttonHeight() const;
 
+        //* window class name and class, as matched by window exceptions
+        QString windowClass() const;
+
         //*@name active state change animation
         //@{
         void setOpacity( qreal );
@@ -76,6 +83,10 @@ namespace Lightly
         qreal opacity() const
         { return m_opacity; }
 
+        //* true while the active state change animation runs
+        bool isAnimated() const
+        { return m_animation.isRunning(); }
+
         //@}
 
         //*@name colors
@@ -104,23 +115,51 @@ namespace Lightly
 
         private Q_SLOTS:
         void reconfigure();
-        void updateBlur();
-        void recalculateBorders();
-        void updateButtonsGeometry();
-        void updateButtonsGeometryDelayed();
-        void updateTitleBar();
         void updateAnimationState();
-        void updateSizeGripVisibility();
+
+        //* recompute all stale parts of the layout
+        void updateLayout();
 
         private:
 
+        //* parts of the layout that can become stale
+        enum LayoutFlag
+        {
+            LayoutBorders = 1<<0,
+            LayoutTitleBar = 1<<1,
+            LayoutButtons = 1<<2,
+            LayoutBlur = 1<<3,
+            LayoutSizeGrip = 1<<4
+        };
+
+        //* mark parts of the layout as stale, they are recomputed once per event loop iteration
+        void scheduleLayout( int flags );
+
+        //*@name layout passes, in the order they run
+        //@{
+        void recalculateBorders();
+        void updateTitleBar();
+        void updateButtonsGeometry();
+        void updateBlur();
+        void updateSizeGripVisibility();
+        //@}
+
         //* return the rect in which caption will be drawn
         QPair<QRect,Qt::Alignment> captionRect() const;
 
+        //* refresh cached caption bounding rect after caption or font changes
+        void updateCaptionLayout() const;
+
         void createButtons();
         void paintTitleBar(QPainter *painter, const QRect &repaintRegion);
+
+        //* render title bar background and separator, in title bar coordinates
+        void renderTitleBarBackground(QPainter *painter, const QRect &titleRect) const;
         void createShadow();
 
+        //* render the shadow texture for given settings
+        static QSharedPointer<KDecoration2::DecorationShadow> renderShadow(int shadowSize, int shadowStrength, const QColor &shadowColor, int windowCornerRadius);
+
         //*@name border size
         //@{
         int borderSize(bool bottom = false) const;
@@ -145,11 +184,78 @@ namespace Lightly
         SizeGrip *m_sizeGrip = nullptr;
 
         //* active state change animation
-        QVariantAnimation *m_animation;
+        Transition m_animation;
 
         //* active state change opacity
         qreal m_opacity = 0;
 
+        //* stale parts of the layout
+        int m_dirtyLayout = 0;
+
+        //* last blur region passed to KWin
+        QRegion m_blurRegion;
+
+        //* everything the cached title bar background depends on
+        struct TitleBarCacheKey
+        {
+            QSize size;
+            qreal devicePixelRatio;
+            bool gradient;
+            QRgb titleBarColor;
+            QRgb outlineColor;
+            int cornerRadius;
+            bool maximized;
+            bool shaded;
+            bool alphaChannelSupported;
+            bool leftEdge;
+            bool topEdge;
+            bool rightEdge;
+            int renderHints;
+
+            bool operator==(const TitleBarCacheKey &other) const
+            {
+                return size == other.size
+                    && devicePixelRatio == other.devicePixelRatio
+                    && gradient == other.gradient
+                    && titleBarColor == other.titleBarColor
+                    && outlineColor == other.outlineColor
+                    && cornerRadius == other.cornerRadius
+                    && maximized == other.maximized
+                    && shaded == other.shaded
+                    && alphaChannelSupported == other.alphaChannelSupported
+                    && leftEdge == other.leftEdge
+                    && topEdge == other.topEdge
+                    && rightEdge == other.rightEdge
+                    && renderHints == other.renderHints;
+            }
+        };
+
+        //* window class, fetched once per client
+        mutable QString m_windowClass;
+
+        //* cached caption layout
+        struct CaptionLayout
+        {
+            //* caption and font the layout was computed for
+            QString caption;
+            QFont font;
+
+            //* unelided caption bounding rect
+            QRect boundingRect;
+
+            //* available width the caption was elided to, -1 if unset
+            int elidedWidth = -1;
+
+            //* elided caption
+            QStaticText staticText;
+        };
+
+        mutable CaptionLayout m_captionLayout;
+
+        //* cached title bar background
+        QPixmap m_titleBarCache;
+        TitleBarCacheKey m_titleBarCacheKey = {};
+
     };
 
     bool Decoration::hasBorders() const
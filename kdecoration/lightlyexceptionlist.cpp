@@ -31,7 +31,7 @@ namespace Lightly
 {
 
     //______________________________________________________________
-    void ExceptionList::readConfig( KSharedConfig::Ptr config )
+    void ExceptionList::readConfig( KSharedConfig::Ptr config, const InternalSettingsPtr& defaults )
     {
 
         _exceptions.clear();
@@ -48,7 +48,17 @@ namespace Lightly
 
             // create new configuration
             InternalSettingsPtr configuration( new InternalSettings() );
-            configuration.data()->load();
+            if( defaults )
+            {
+
+                // copy already loaded defaults rather than parsing the config file again
+                foreach( KConfigSkeletonItem* item, defaults->items() )
+                {
+                    KConfigSkeletonItem* target( configuration->findItem( item->name() ) );
+                    if( target ) target->setProperty( item->property() );
+                }
+
+            } else configuration.data()->load();
 
             // apply changes from exception
             configuration->setEnabled( exception.enabled() );
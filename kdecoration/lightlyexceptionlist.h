@@ -51,7 +51,11 @@ namespace Lightly
         { return _exceptions; }
 
         //! read from KConfig
-        void readConfig( KSharedConfig::Ptr );
+        /*!
+        exceptions start from a copy of the given default settings if any,
+        otherwise the default settings are loaded again for each exception
+        */
+        void readConfig( KSharedConfig::Ptr, const InternalSettingsPtr& defaults = InternalSettingsPtr() );
 
         //! write to kconfig
         void writeConfig( KSharedConfig::Ptr );
@@ -22,8 +22,6 @@
 
 #include "lightlyexceptionlist.h"
 
-#include <KWindowInfo>
-
 #include <QTextStream>
 
 namespace Lightly
@@ -53,30 +51,33 @@ namespace Lightly
     //__________________________________________________________________
     void SettingsProvider::reconfigure()
     {
-        if( !m_defaultSettings )
-        {
-            m_defaultSettings = InternalSettingsPtr(new InternalSettings());
-            m_defaultSettings->setCurrentGroup( QStringLiteral("Windeco") );
-        }
-
-        m_defaultSettings->load();
+        // lightlyrc is parsed once, here; exceptions are then built from the loaded defaults
+        InternalSettingsPtr defaultSettings( new InternalSettings() );
+        defaultSettings->setCurrentGroup( QStringLiteral("Windeco") );
+        defaultSettings->load();
 
         ExceptionList exceptions;
-        exceptions.readConfig( m_config );
-        m_exceptions = exceptions.get();
+        exceptions.readConfig( m_config, defaultSettings );
 
-    }
+        /*
+        keep the previous settings objects when nothing changed,
+        so that decorations can tell they have nothing to update
+        */
+        const bool defaultsChanged( !isEquivalent( m_defaultSettings, defaultSettings ) );
+        if( defaultsChanged ) m_defaultSettings = defaultSettings;
 
-    //__________________________________________________________________
-    InternalSettingsPtr SettingsProvider::internalSettings( Decoration *decoration ) const
-    {
+        bool exceptionsChanged( defaultsChanged || exceptions.get().size() != m_exceptions.size() );
+        for( int index = 0; !exceptionsChanged && index < m_exceptions.size(); ++index )
+        { exceptionsChanged = !isEquivalent( m_exceptions.at( index ), exceptions.get().at( index ) ); }
 
-        QString windowTitle;
-        QString className;
+        if( !exceptionsChanged ) return;
 
-        // get the client
-        auto client = decoration->client().data();
+        m_exceptions = exceptions.get();
 
+        // compile exception patterns once, rather than for every decoration
+        m_compiledExceptions.clear();
+        m_hasTitleExceptions = false;
+        m_hasClassExceptions = false;
         foreach( auto internalSettings, m_exceptions )
         {
 
@@ -86,44 +87,75 @@ namespace Lightly
             // discard exceptions with empty exception pattern
             if( internalSettings->exceptionPattern().isEmpty() ) continue;
 
+            CompiledException exception;
+            exception.settings = internalSettings;
+            exception.pattern = QRegularExpression( internalSettings->exceptionPattern() );
+            exception.pattern.optimize();
+            exception.type = internalSettings->exceptionType() == InternalSettings::ExceptionWindowTitle ?
+                InternalSettings::ExceptionWindowTitle:
+                InternalSettings::ExceptionWindowClassName;
+
+            if( exception.type == InternalSettings::ExceptionWindowTitle ) m_hasTitleExceptions = true;
+            else m_hasClassExceptions = true;
+
+            m_compiledExceptions.append( exception );
+
+        }
+
+        m_matches.clear();
+
+    }
+
+    //__________________________________________________________________
+    bool SettingsProvider::isEquivalent( const InternalSettingsPtr &first, const InternalSettingsPtr &second )
+    {
+        if( first == second ) return true;
+        if( !( first && second ) ) return false;
+
+        foreach( KConfigSkeletonItem* item, first->items() )
+        {
+            const KConfigSkeletonItem* other( second->findItem( item->name() ) );
+            if( !( other && other->property() == item->property() ) ) return false;
+        }
+
+        return true;
+    }
+
+    //__________________________________________________________________
+    InternalSettingsPtr SettingsProvider::internalSettings( Decoration *decoration ) const
+    {
+
+        if( m_compiledExceptions.isEmpty() ) return m_defaultSettings;
+
+        // only fetch what the exceptions actually match on
+        const QString windowTitle( m_hasTitleExceptions ? decoration->client().data()->caption() : QString() );
+        const QString className( m_hasClassExceptions ? decoration->windowClass() : QString() );
+
+        const QPair<QString, QString> key( className, windowTitle );
+        auto iter = m_matches.constFind( key );
+        if( iter != m_matches.constEnd() ) return iter.value();
+
+        InternalSettingsPtr settings( m_defaultSettings );
+        for( const CompiledException &exception : m_compiledExceptions )
+        {
+
             /*
             decide which value is to be compared
             to the regular expression, based on exception type
             */
-            QString value;
-            switch( internalSettings->exceptionType() )
-            {
-                case InternalSettings::ExceptionWindowTitle:
-                {
-                    value = windowTitle.isEmpty() ? (windowTitle = client->caption()):windowTitle;
-                    break;
-                }
-
-                default:
-                case InternalSettings::ExceptionWindowClassName:
-                {
-                    if( className.isEmpty() )
-                    {
-                        // retrieve class name
-                        KWindowInfo info( client->windowId(), nullptr, NET::WM2WindowClass );
-                        QString window_className( QString::fromUtf8(info.windowClassName()) );
-                        QString window_class( QString::fromUtf8(info.windowClassClass()) );
-                        className = window_className + QStringLiteral(" ") + window_class;
-                    }
-
-                    value = className;
-                    break;
-                }
-
-            }
+            const QString &value( exception.type == InternalSettings::ExceptionWindowTitle ? windowTitle : className );
 
             // check matching
-            if( QRegExp( internalSettings->exceptionPattern() ).indexIn( value ) >= 0 )
-            { return internalSettings; }
+            if( exception.pattern.match( value ).hasMatch() )
+            {
+                settings = exception.settings;
+                break;
+            }
 
         }
 
-        return m_defaultSettings;
+        m_matches.insert( key, settings );
+        return settings;
 
     }
 
@@ -26,7 +26,11 @@
 
 #include <KSharedConfig>
 
+#include <QHash>
 #include <QObject>
+#include <QPair>
+#include <QRegularExpression>
+#include <QVector>
 
 namespace Lightly
 {
@@ -47,6 +51,9 @@ namespace Lightly
         //* internal settings for given decoration
         InternalSettingsPtr internalSettings(Decoration *) const;
 
+        //* true if both settings hold the same values
+        static bool isEquivalent( const InternalSettingsPtr&, const InternalSettingsPtr& );
+
         public Q_SLOTS:
 
         //* reconfigure
@@ -63,6 +70,24 @@ namespace Lightly
         //* exceptions
         InternalSettingsList m_exceptions;
 
+        //* enabled exception, with its pattern compiled
+        struct CompiledException
+        {
+            InternalSettingsPtr settings;
+            QRegularExpression pattern;
+            int type;
+        };
+
+        //* enabled exceptions, compiled once per reconfigure
+        QVector<CompiledException> m_compiledExceptions;
+
+        //* whether any exception matches on window title, resp. class name
+        bool m_hasTitleExceptions = false;
+        bool m_hasClassExceptions = false;
+
+        //* matched settings per window class and caption, until next reconfigure
+        mutable QHash<QPair<QString, QString>, InternalSettingsPtr> m_matches;
+
         //* config object
         KSharedConfigPtr m_config;
 
@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lightlytransition.h"
+
+#include <QEasingCurve>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+
+namespace Lightly
+{
+
+    //* advances all running transitions of the plugin, once per frame
+    class TransitionClock
+    {
+
+        public:
+
+        //* constructor
+        TransitionClock()
+        {
+            m_timer.setTimerType( Qt::PreciseTimer );
+            m_timer.setInterval( 16 );
+            QObject::connect( &m_timer, &QTimer::timeout, &m_timer, [this]() { tick(); } );
+        }
+
+        //* register a transition
+        void add( Transition *transition, const Transition::Callback &callback )
+        {
+            for( Entry &entry : m_entries )
+            {
+                if( entry.transition == transition )
+                {
+                    entry.callback = callback;
+                    return;
+                }
+            }
+
+            m_entries.append( { transition, callback } );
+            if( !m_timer.isActive() )
+            {
+                m_elapsed.start();
+                m_timer.start();
+            }
+        }
+
+        //* unregister a transition
+        void remove( Transition *transition )
+        {
+            for( int i = 0; i < m_entries.size(); ++i )
+            {
+                if( m_entries.at( i ).transition == transition )
+                {
+                    m_entries.remove( i );
+                    break;
+                }
+            }
+
+            if( m_entries.isEmpty() ) m_timer.stop();
+        }
+
+        private:
+
+        //* advance all transitions and let their owners repaint
+        void tick()
+        {
+            const qint64 elapsed( m_elapsed.restart() );
+
+            // callbacks may start or destroy transitions, so iterate over a copy
+            const QVector<Entry> entries( m_entries );
+            for( const Entry &entry : entries )
+            {
+                if( !contains( entry.transition ) ) continue;
+
+                const qreal value( entry.transition->advance( elapsed ) );
+                if( !entry.transition->m_running ) remove( entry.transition );
+                entry.callback( value );
+            }
+        }
+
+        //* true if transition is registered
+        bool contains( const Transition *transition ) const
+        {
+            for( const Entry &entry : m_entries )
+            { if( entry.transition == transition ) return true; }
+            return false;
+        }
+
+        struct Entry
+        {
+            Transition *transition;
+            Transition::Callback callback;
+        };
+
+        QVector<Entry> m_entries;
+        QTimer m_timer;
+        QElapsedTimer m_elapsed;
+
+    };
+
+    Q_GLOBAL_STATIC( TransitionClock, s_clock )
+
+    //________________________________________________________________
+    Transition::~Transition()
+    {
+        if( m_running && !s_clock.isDestroyed() ) s_clock()->remove( this );
+    }
+
+    //________________________________________________________________
+    void Transition::start( bool forward, const Callback &callback )
+    {
+        m_forward = forward;
+        if( m_duration <= 0 )
+        {
+            // no animation, jump to the end right away
+            if( m_running ) s_clock()->remove( this );
+            m_running = false;
+            m_progress = forward ? 1 : 0;
+            callback( m_progress );
+            return;
+        }
+
+        m_running = true;
+        s_clock()->add( this, callback );
+    }
+
+    //________________________________________________________________
+    qreal Transition::advance( qint64 elapsed )
+    {
+        const float step( float( elapsed )/m_duration );
+        m_progress = qBound( 0.0f, m_progress + ( m_forward ? step : -step ), 1.0f );
+        if( m_progress == ( m_forward ? 1.0f : 0.0f ) ) m_running = false;
+
+        static const QEasingCurve easingCurve( QEasingCurve::InOutQuad );
+        return easingCurve.valueForProgress( m_progress );
+    }
+
+}
@@ -0,0 +1,84 @@
+#ifndef LIGHTLY_TRANSITION_H
+#define LIGHTLY_TRANSITION_H
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtGlobal>
+
+#include <functional>
+
+namespace Lightly
+{
+
+    //* animated value going back and forth between 0 and 1
+    /**
+    all running transitions of the plugin are advanced together by a single
+    shared clock, so that an idle transition is only a few bytes of state
+    */
+    class Transition
+    {
+
+        public:
+
+        //* called with the eased value on every frame
+        using Callback = std::function<void(qreal)>;
+
+        //* constructor
+        Transition() = default;
+
+        //* destructor
+        ~Transition();
+
+        //* duration of a full transition, in milliseconds
+        void setDuration( int value )
+        { m_duration = value; }
+
+        //* true while the transition is advanced by the clock
+        bool isRunning() const
+        { return m_running; }
+
+        //* move towards 1 if forward, towards 0 otherwise, starting from the current value
+        void start( bool forward, const Callback &callback );
+
+        private:
+
+        Q_DISABLE_COPY( Transition )
+
+        friend class TransitionClock;
+
+        //* advance by given time, in milliseconds, and return the eased value
+        qreal advance( qint64 elapsed );
+
+        //* linear progress
+        float m_progress = 0;
+
+        //* duration
+        int m_duration = 0;
+
+        //* direction
+        bool m_forward = true;
+
+        //* registered with the clock
+        bool m_running = false;
+
+    };
+
+}
+
+#endif
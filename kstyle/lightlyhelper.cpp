@@ -20,12 +20,14 @@
 #include "lightlyhelper.h"
 
 #include "lightly.h"
+#include "lightlyboxblur.h"
 
 #include <KColorUtils>
 #include <KIconLoader>
 #include <KWindowSystem>
 
 #include <QApplication>
+#include <QCache>
 #include <QPainter>
 #include <QtMath>
 
@@ -37,6 +39,171 @@
 
 //#include <QDebug>
 
+namespace
+{
+
+    //* ellipse shadow texture cache key
+    struct EllipseShadowKey
+    {
+        QSize size;
+        QRgb color;
+        int shadowSize;
+        int param1;
+        int param2;
+        QPoint offset;
+        int dpr;
+    };
+
+    inline bool operator==( const EllipseShadowKey& lhs, const EllipseShadowKey& rhs )
+    {
+        return lhs.size == rhs.size && lhs.color == rhs.color && lhs.shadowSize == rhs.shadowSize
+            && lhs.param1 == rhs.param1 && lhs.param2 == rhs.param2
+            && lhs.offset == rhs.offset && lhs.dpr == rhs.dpr;
+    }
+
+    inline uint qHash( const EllipseShadowKey& key, uint seed = 0 )
+    {
+        uint hash = ::qHash( key.color, seed );
+        auto combine = [&hash]( uint value ) { hash ^= value + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 ); };
+        combine( ::qHash( key.size.width() ) );
+        combine( ::qHash( key.size.height() ) );
+        combine( ::qHash( key.shadowSize ) );
+        combine( ::qHash( key.param1 ) );
+        combine( ::qHash( key.param2 ) );
+        combine( ::qHash( key.offset.x() ) );
+        combine( ::qHash( key.offset.y() ) );
+        combine( ::qHash( key.dpr ) );
+        return hash;
+    }
+
+    //* ellipse shadow texture cache
+    /** animated shadow colors add one entry per frame, so keep room for a few animations */
+    using EllipseShadowCache = QCache<EllipseShadowKey, QPixmap>;
+    Q_GLOBAL_STATIC_WITH_ARGS( EllipseShadowCache, s_ellipseShadowCache, ( 128 ) )
+
+    //* checkbox and radio button sprite cache key
+    struct IndicatorKey
+    {
+        int type;
+        QSize size;
+        int state;
+        bool mouseOver;
+        bool sunken;
+        bool isInMenu;
+        bool windowActive;
+        bool darkTheme;
+        QRgb highlight;
+        QRgb button;
+        QRgb highlightedText;
+        int animationStep;
+        int dpr;
+    };
+
+    inline bool operator==( const IndicatorKey& lhs, const IndicatorKey& rhs )
+    {
+        return lhs.type == rhs.type && lhs.size == rhs.size && lhs.state == rhs.state
+            && lhs.mouseOver == rhs.mouseOver && lhs.sunken == rhs.sunken
+            && lhs.isInMenu == rhs.isInMenu && lhs.windowActive == rhs.windowActive
+            && lhs.darkTheme == rhs.darkTheme
+            && lhs.highlight == rhs.highlight && lhs.button == rhs.button && lhs.highlightedText == rhs.highlightedText
+            && lhs.animationStep == rhs.animationStep && lhs.dpr == rhs.dpr;
+    }
+
+    inline uint qHash( const IndicatorKey& key, uint seed = 0 )
+    {
+        uint hash = ::qHash( key.type, seed );
+        auto combine = [&hash]( uint value ) { hash ^= value + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 ); };
+        combine( ::qHash( key.size.width() ) );
+        combine( ::qHash( key.size.height() ) );
+        combine( ::qHash( key.state ) );
+        combine( uint( key.mouseOver ) | uint( key.sunken ) << 1 | uint( key.isInMenu ) << 2 | uint( key.windowActive ) << 3 | uint( key.darkTheme ) << 4 );
+        combine( ::qHash( key.highlight ) );
+        combine( ::qHash( key.button ) );
+        combine( ::qHash( key.highlightedText ) );
+        combine( ::qHash( key.animationStep ) );
+        combine( ::qHash( key.dpr ) );
+        return hash;
+    }
+
+    //* checkbox and radio button sprite cache
+    /** animated indicators add one entry per animation step, hence the larger size */
+    using IndicatorCache = QCache<IndicatorKey, QPixmap>;
+    Q_GLOBAL_STATIC_WITH_ARGS( IndicatorCache, s_indicatorCache, ( 512 ) )
+
+    //* number of animation steps for which checkbox and radio button sprites are cached
+    const int s_indicatorAnimationSteps = 32;
+
+    //* distance by which the line edit focus shadows extend past the line edit rect
+    /** the largest shadow is 6 pixels wide and offset by one pixel, plus one pixel for antialiasing */
+    const int s_focusRevealMargin = 8;
+
+    //* largest shadow size and offset used by checkbox and radio button indicators
+    const int s_indicatorShadowSize = 5;
+    const QPoint s_indicatorShadowOffset( 0, 1 );
+
+    //* blur radius of the shadow painted by renderEllipseShadow, matching the width of the shadow
+    int ellipseShadowBlurRadius( int size )
+    { return qMax( 1, qRound( 0.5*size ) ); }
+
+    //* distance by which the shadow painted by renderEllipseShadow extends past its ellipse
+    int ellipseShadowMargin( int size, const QPoint& offset )
+    {
+        const int extent( Lightly::calculateBlurRadius( Lightly::calculateBlurStdDev( ellipseShadowBlurRadius( size ) ) ) );
+        return qCeil( 0.5*size ) + extent + qMax( qAbs( offset.x() ), qAbs( offset.y() ) );
+    }
+
+    //* round animation progress to one of the cached steps
+    /** 0, 1 and invalid progress are kept as is, since indicators treat them as distinct states */
+    qreal quantizedAnimation( qreal animation )
+    {
+        if( animation <= 0 || animation == 1 ) return animation;
+        const int step( qRound( animation*s_indicatorAnimationSteps ) );
+        if( animation < 1 ) return qreal( qBound( 1, step, s_indicatorAnimationSteps - 1 ) )/s_indicatorAnimationSteps;
+        else return qreal( qMax( s_indicatorAnimationSteps + 1, step ) )/s_indicatorAnimationSteps;
+    }
+
+    //* render a checkbox or radio button from the sprite cache, painting the sprite with the given function if needed
+    /** margin is the distance by which the indicator shadows extend past rect */
+    template<typename Paint>
+    void renderIndicator( QPainter* painter, const QRect& rect, int margin, IndicatorKey key, Paint paint )
+    {
+
+        // sprites are only pixel exact for integer translations
+        const QTransform& transform( painter->transform() );
+        if( !rect.isValid() || transform.type() > QTransform::TxTranslate
+            || transform.dx() != qRound( transform.dx() ) || transform.dy() != qRound( transform.dy() ) )
+        {
+            painter->save();
+            paint( painter, rect );
+            painter->restore();
+            return;
+        }
+
+        const qreal dpr( painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() );
+        key.size = rect.size();
+        key.dpr = qRound( dpr*100 );
+
+        const QRect spriteRect( rect.adjusted( -margin, -margin, margin, margin ) );
+        QPixmap* sprite( s_indicatorCache->object( key ) );
+        if( !sprite )
+        {
+            sprite = new QPixmap( spriteRect.size()*dpr );
+            sprite->setDevicePixelRatio( dpr );
+            sprite->fill( Qt::transparent );
+
+            QPainter p( sprite );
+            paint( &p, QRect( QPoint( margin, margin ), rect.size() ) );
+            p.end();
+
+            s_indicatorCache->insert( key, sprite );
+        }
+
+        painter->drawPixmap( spriteRect.topLeft(), *sprite );
+
+    }
+
+}
+
 namespace Lightly
 {
 
@@ -45,11 +212,13 @@ namespace Lightly
 
     //____________________________________________________________________
     Helper::Helper( KSharedConfig::Ptr config, QObject *parent ):
-        _config( std::move( config ) )
+        _config( std::move( config ) ),
+        _buttonFrameCache( 256 )
     {
 
         if ( qApp ) {
             connect(qApp, &QApplication::paletteChanged, this, [=]() {
+                if( s_indicatorCache.exists() ) s_indicatorCache->clear();
                 if (qApp->property("KDE_COLOR_SCHEME_PATH").isValid()) {
                     const auto path = qApp->property("KDE_COLOR_SCHEME_PATH").toString();
                     KConfig config(path, KConfig::SimpleConfig);
@@ -78,6 +247,10 @@ namespace Lightly
         _viewNegativeTextBrush = KStatefulBrush( KColorScheme::View, KColorScheme::NegativeText );
         _windowAlternateBackgroundBrush = KStatefulBrush( KColorScheme::Window, KColorScheme::AlternateBackground );
 
+        // corner radius and shadow settings are not part of the button frame and indicator sprite keys
+        _buttonFrameCache.clear();
+        if( s_indicatorCache.exists() ) s_indicatorCache->clear();
+
         const QPalette palette( QApplication::palette() );
 
         KConfig config(qApp->property("KDE_COLOR_SCHEME_PATH").toString(), KConfig::SimpleConfig);
@@ -641,46 +814,129 @@ namespace Lightly
         if ( size < 1 ) return;
         if (color.alphaF() < 0.01) return;
 
-        // temporaty values
-        int tx = rect.left() - size + xOffset;
-        int ty = rect.top() - size + yOffset;
-        int tw = rect.width() + size * 2;
-        int th = rect.height() + size * 2;
-        float alpha = color.alphaF();
+        const qreal dpr( painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() );
+        const QSize ellipseSize( qCeil( rect.width() ), qCeil( rect.height() ) );
+        const EllipseShadowKey key = {
+            ellipseSize, color.rgba(), size,
+            qRound( param1*100 ), qRound( param2*100 ),
+            QPoint( xOffset, yOffset ),
+            qRound( dpr*100 )
+        };
+
+        // blur radius matching the width of the shadow, and how far the blur reaches past the ellipse
+        const int blurRadius( ellipseShadowBlurRadius( size ) );
+        const int extent( calculateBlurRadius( calculateBlurStdDev( blurRadius ) ) );
+        const QSizeF textureSize( ellipseSize + QSize( size + 2*extent, size + 2*extent ) );
+
+        QPixmap* texture( s_ellipseShadowCache->object( key ) );
+        if( !texture )
+        {
 
-        while (tx <= rect.left() + qMax(xOffset, yOffset)) {
+            // the shadow used to be painted as concentric ellipses, one per pixel of size,
+            // each adding param1 + alpha/param2 to the previous alpha.
+            // The opacity reached at the ellipse edge is used as the shadow opacity
+            qreal alpha( qAlpha( key.color )/255.0 );
+            qreal transparency( 1.0 );
+            for( int i = 0; i <= size; ++i )
+            {
+                transparency *= 1.0 - qMin( int( alpha ), 255 )/255.0;
+                alpha += param1 + alpha/param2;
+            }
 
-            color.setAlpha( alpha );
-            painter->setBrush( color );
+            // ellipse grown by half the shadow size, blurred so that the falloff spans the full size
+            QImage image( ( textureSize*dpr ).toSize(), QImage::Format_ARGB32_Premultiplied );
+            image.setDevicePixelRatio( dpr );
+            image.fill( Qt::transparent );
 
-            painter->drawEllipse( QRect(tx, ty, tw, th) );
+            QPainter p( &image );
+            p.setRenderHint( QPainter::Antialiasing );
+            p.setPen( Qt::NoPen );
+            p.setBrush( Qt::black );
+            p.drawEllipse( QRectF( extent, extent, ellipseSize.width() + size, ellipseSize.height() + size ) );
+            p.end();
+
+            boxBlurAlpha( image, qRound( blurRadius*dpr ) );
+
+            QColor shadowColor( color );
+            shadowColor.setAlphaF( 1.0 - transparency );
+            p.begin( &image );
+            p.setCompositionMode( QPainter::CompositionMode_SourceIn );
+            p.fillRect( QRectF( QPointF(), textureSize ), shadowColor );
+            p.end();
+
+            texture = new QPixmap( QPixmap::fromImage( image ) );
+            s_ellipseShadowCache->insert( key, texture );
 
-            tx++;
-            ty++;
-            tw -= 2;
-            th -= 2;
-            alpha += param1 + alpha/param2;
         }
+
+        // scale the texture to the actual ellipse size
+        const QRectF target(
+            rect.left() - 0.5*size - extent + xOffset,
+            rect.top() - 0.5*size - extent + yOffset,
+            rect.width() + size + 2*extent,
+            rect.height() + size + 2*extent );
+
+        const bool smooth( painter->testRenderHint( QPainter::SmoothPixmapTransform ) );
+        painter->setRenderHint( QPainter::SmoothPixmapTransform, true );
+        painter->drawPixmap( target, *texture, QRectF( QPointF(), texture->size() ) );
+        painter->setRenderHint( QPainter::SmoothPixmapTransform, smooth );
     }
 
     //______________________________________________________________________________
     void Helper::topHighlight( QPainter* painter, const QRectF& rect, const int radius, const QColor& color ) const
     {
-        QPixmap pixmap = QPixmap(rect.width(), rect.height());
-        pixmap.fill( Qt::transparent );
-        QPainter p( &pixmap );
+        const int width( rect.width() );
+        const int height( rect.height() );
+        if( width <= 0 || height <= 0 ) return;
+
+        // the highlight only differs from a straight line along the rounded corners,
+        // so render it once per radius as a sprite and stretch its middle column
+        const int effectiveRadius( qMax( 0, qMin( radius, qMin( width, height )/2 ) ) );
+        const int spriteHeight( qMin( effectiveRadius + 2, height ) );
+        const qreal dpr( painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() );
+
+        const quint64 key( ( quint64( color.rgba() ) << 32 ) | ( quint64( qRound( dpr*100 ) & 0xffff ) << 16 ) | quint64( effectiveRadius & 0xffff ) );
+        QPixmap* sprite( _topHighlightCache.object( key ) );
+        if( !sprite )
+        {
+            const int spriteWidth( 2*effectiveRadius + 1 );
+            sprite = new QPixmap( qCeil( spriteWidth*dpr ), qCeil( spriteHeight*dpr ) );
+            sprite->setDevicePixelRatio( dpr );
+            sprite->fill( Qt::transparent );
+
+            QPainter p( sprite );
+            p.setRenderHint( QPainter::Antialiasing );
+
+            // rects are made tall enough for their bottom corners to fall outside the sprite
+            p.setPen( Qt::NoPen );
+            p.setBrush( color );
+            p.drawRoundedRect( QRect( 0, 0, spriteWidth, 2*spriteHeight ), effectiveRadius, effectiveRadius );
+
+            p.setCompositionMode( QPainter::CompositionMode_DestinationOut );
+            p.setBrush( Qt::black );
+            p.drawRoundedRect( QRect( 0, 1, spriteWidth, 2*spriteHeight ), effectiveRadius, effectiveRadius );
+            p.end();
 
-        p.setRenderHint( QPainter::Antialiasing );
+            _topHighlightCache.insert( key, sprite );
+        }
 
-        p.setPen( Qt::NoPen );
-        p.setBrush( color );
-        p.drawRoundedRect( QRect( 0, 0, rect.width(), rect.height() ), radius, radius );
+        // three slices: left corner, stretched middle column, right corner
+        const qreal x( int( rect.x() ) );
+        const qreal y( int( rect.y() ) );
+        const qreal corner( effectiveRadius*dpr );
+        const qreal sourceHeight( spriteHeight*dpr );
 
-        p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-        p.setBrush( Qt::black );
-        p.drawRoundedRect( QRect( 0, 1, rect.width(), rect.height() ), radius, radius );
+        painter->save();
+        painter->setRenderHint( QPainter::SmoothPixmapTransform, false );
+        if( effectiveRadius > 0 )
+        {
+            painter->drawPixmap( QRectF( x, y, effectiveRadius, spriteHeight ), *sprite, QRectF( 0, 0, corner, sourceHeight ) );
+            painter->drawPixmap( QRectF( x + width - effectiveRadius, y, effectiveRadius, spriteHeight ), *sprite, QRectF( corner + dpr, 0, corner, sourceHeight ) );
+        }
 
-        painter->drawPixmap( QRect( rect.x(), rect.y(), rect.width(), rect.height() ), pixmap );
+        if( width > 2*effectiveRadius )
+        { painter->drawPixmap( QRectF( x + effectiveRadius, y, width - 2*effectiveRadius, spriteHeight ), *sprite, QRectF( corner, 0, dpr, sourceHeight ) ); }
+        painter->restore();
 
     }
 
@@ -691,6 +947,8 @@ namespace Lightly
         const bool hasFocus, const bool sunken, const  bool mouseOver, const bool enabled, const bool windowActive, const AnimationMode mode, const qreal opacity ) const
      {
 
+        Q_UNUSED( windowActive )
+
         // setup painter
         painter->setRenderHint( QPainter::Antialiasing, true );
 
@@ -704,33 +962,43 @@ namespace Lightly
 
         qreal radius( frameRadius() - 1 );
 
+        // shadow
+        int shadowSize( 0 );
+        QColor shadowColor;
         if( sunken ) {
 
             frameRect.translate( 0, 1 );
-            renderBoxShadow( painter, frameRect, 0, 1, 2, QColor( 0, 0, 0, 120 ), radius, windowActive );
+            shadowSize = 2;
+            shadowColor = QColor( 0, 0, 0, 120 );
 
-        } else if ( enabled && color.alphaF() == 1 ) { // shadow
+        } else if ( enabled && color.alphaF() == 1 ) {
 
             if ( mouseOver || hasFocus ){
                 //frameRect.translate( 0, -1 ); feels cheap without animations
 
-                QColor shadowColor = hasFocus ? color.darker(220) : QColor( 0 ,0 ,0 ,170 );
-                renderBoxShadow( painter, frameRect, 0, 1, 6, shadowColor, radius, windowActive );
+                shadowSize = 6;
+                shadowColor = hasFocus ? color.darker(220) : QColor( 0 ,0 ,0 ,170 );
 
-            } else
-                renderBoxShadow( painter, frameRect, 0, 1, 3, QColor( 0, 0, 0, 120 ), radius, windowActive );
+            } else {
+
+                shadowSize = 3;
+                shadowColor = QColor( 0, 0, 0, 120 );
+
+            }
         }
 
         // content
-        if( color.isValid() )
-            painter->setBrush( sunken ? focusColor(palette).darker(110) : mouseOver ? color.lighter( hasFocus ? 102 : 105 ) : color );
-
-        else painter->setBrush( Qt::NoBrush );
+        QColor fill;
+        if( color.isValid() ) fill = sunken ? focusColor(palette).darker(110) : mouseOver ? color.lighter( hasFocus ? 102 : 105 ) : color;
 
-        // render
-        painter->drawRoundedRect( frameRect, radius, radius );
+        // render shadow, content and highlight
+        // hover and focus animations change the colors on every frame, so these are painted directly rather than cached
+        const bool highlight( isDarkTheme( palette ) && enabled );
+        if( mode == AnimationHover || mode == AnimationFocus ) renderButtonFrameContents( painter, frameRect, fill, shadowSize, shadowColor, highlight, radius );
+        else renderButtonFrameTiles( painter, frameRect.toRect(), fill, shadowSize, shadowColor, highlight, radius );
 
-        if( isDarkTheme( palette ) && enabled ) topHighlight( painter, frameRect, StyleConfigData::cornerRadius() );
+        if( fill.isValid() ) painter->setBrush( fill );
+        else painter->setBrush( Qt::NoBrush );
 
         // pressed animation
         if (mode == AnimationPressed){
@@ -762,6 +1030,74 @@ namespace Lightly
 
     }
 
+    //______________________________________________________________________________
+    void Helper::renderButtonFrameContents(
+        QPainter* painter, const QRectF& frameRect,
+        const QColor& fill, const int shadowSize, const QColor& shadowColor, const bool highlight, const qreal radius ) const
+    {
+
+        if( shadowSize > 0 ) renderBoxShadow( painter, frameRect, 0, 1, shadowSize, shadowColor, radius, true );
+
+        if( fill.isValid() )
+        {
+            painter->setBrush( fill );
+            painter->drawRoundedRect( frameRect, radius, radius );
+        }
+
+        if( highlight ) topHighlight( painter, frameRect, StyleConfigData::cornerRadius() );
+
+    }
+
+    //______________________________________________________________________________
+    void Helper::renderButtonFrameTiles(
+        QPainter* painter, const QRect& frameRect,
+        const QColor& fill, int shadowSize, const QColor& shadowColor, const bool highlight, const qreal radius ) const
+    {
+
+        if( !frameRect.isValid() ) return;
+        if( !StyleConfigData::widgetDrawShadow() ) shadowSize = 0;
+
+        const qreal dpr( painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() );
+        const ButtonFrameKey key = {
+            fill.rgba(), fill.isValid(),
+            shadowSize, shadowSize > 0 ? shadowColor.rgba() : 0,
+            highlight,
+            qRound( radius*100 ),
+            qRound( dpr*100 )
+        };
+
+        // the box shadow extends by its size, plus one pixel of vertical offset
+        const int margin( shadowSize + 1 );
+
+        TileSet* tiles( _buttonFrameCache.object( key ) );
+        if( !tiles )
+        {
+
+            // the template frame is large enough for every corner, including the shadow ones,
+            // to be rendered unclipped, with a single pixel wide stretchable center
+            const int corner( qCeil( qMax( radius, qreal( StyleConfigData::cornerRadius() ) ) ) + 2*margin );
+            const QRect templateRect( margin, margin, 2*corner + 1, 2*corner + 1 );
+            const QSize size( templateRect.size() + QSize( 2*margin, 2*margin ) );
+
+            QPixmap pixmap( size*dpr );
+            pixmap.setDevicePixelRatio( dpr );
+            pixmap.fill( Qt::transparent );
+
+            QPainter p( &pixmap );
+            p.setRenderHint( QPainter::Antialiasing, true );
+            p.setPen( Qt::NoPen );
+            renderButtonFrameContents( &p, templateRect, fill, shadowSize, shadowColor, highlight, radius );
+            p.end();
+
+            tiles = new TileSet( pixmap, margin + corner, margin + corner, 1, 1 );
+            _buttonFrameCache.insert( key, tiles );
+
+        }
+
+        tiles->render( frameRect.adjusted( -margin, -margin, margin, margin ), painter, TileSet::Full );
+
+    }
+
     //______________________________________________________________________________
     void Helper::renderToolButtonFrame(
         QPainter* painter, const QRect& rect,
@@ -909,6 +1245,19 @@ namespace Lightly
 
     }
 
+    //______________________________________________________________________________
+    QPixmap& Helper::focusRevealLayer( const QSize& size, qreal dpr ) const
+    {
+        if( _focusRevealLayer.size() != size*dpr || _focusRevealLayer.devicePixelRatio() != dpr )
+        {
+            _focusRevealLayer = QPixmap( size*dpr );
+            _focusRevealLayer.setDevicePixelRatio( dpr );
+        }
+
+        _focusRevealLayer.fill( Qt::transparent );
+        return _focusRevealLayer;
+    }
+
     //______________________________________________________________________________
     void Helper::renderLineEdit(
         QPainter* painter, const QRect& rect,
@@ -941,25 +1290,13 @@ namespace Lightly
 
                     const qreal finalRadius ((frameRect.width()+Metrics::Frame_FrameWidth)*opacity);
 
-                    QPixmap mask = QPixmap(rect.width(), rect.height());
-                    mask.fill( Qt::transparent );
-
-                    QPainter pmask( &mask );
-                    pmask.setRenderHint( QPainter::Antialiasing );
-                    pmask.fillRect(rect, Qt::black);
-                    pmask.setPen( Qt::NoPen );
-                    pmask.setBrush( Qt::black );
-                    pmask.setCompositionMode(QPainter::CompositionMode_SourceOut);
-                    pmask.drawEllipse(QPointF(frameRect.x(), frameRect.y() + frameRect.height()/2), finalRadius, finalRadius);
-                    pmask.end();
-
-                    QPixmap pixmap = QPixmap(rect.width(), rect.height());
-                    pixmap.fill( Qt::transparent );
-                    QPainter p( &pixmap );
-                    p.setOpacity(0.3 + 0.7*opacity);
+                    // the focus frame is revealed by a circle growing from its left edge.
+                    // It is drawn into a layer reused across frames, and masked with an antialiased circle
+                    const QRect layerRect( rect.adjusted( -s_focusRevealMargin, -s_focusRevealMargin, s_focusRevealMargin, s_focusRevealMargin ) );
+                    QPainter p( &focusRevealLayer( layerRect.size(), painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() ) );
                     p.setRenderHint( QPainter::Antialiasing );
-                    p.setCompositionMode(QPainter::CompositionMode_SourceOver);
-                    p.setPen(Qt::NoPen);
+                    p.setPen( Qt::NoPen );
+                    p.translate( -layerRect.topLeft() );
                     renderBoxShadow( &p, frameRect, 0, 1, 6, outline.darker(120) , radius, windowActive ); // comment this out for only the outline animation
                     renderBoxShadow( &p, frameRect, 0, 1, 4, outline.darker(130) , radius, windowActive ); // comment this out for only the outline animation
                     renderBoxShadow( &p, frameRect, 0, 1, 4, outline.darker(140) , radius, windowActive ); // comment this out for only the outline animation
@@ -968,12 +1305,15 @@ namespace Lightly
                     p.drawRoundedRect( focusFrame, radius + 1, radius + 1); // outline around lineedit
 
                     // mask
-                    //p.setOpacity(1);  // uncomment this for only outline animation
-                    p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-                    p.drawPixmap(rect, mask);
+                    p.setCompositionMode( QPainter::CompositionMode_DestinationIn );
+                    p.setBrush( Qt::black );
+                    p.drawEllipse( QPointF( frameRect.x(), frameRect.y() + frameRect.height()/2 ), finalRadius, finalRadius );
                     p.end();
 
-                    painter->drawPixmap( rect, pixmap );
+                    const qreal painterOpacity( painter->opacity() );
+                    painter->setOpacity( painterOpacity*(0.3 + 0.7*opacity) );
+                    painter->drawPixmap( layerRect.topLeft(), _focusRevealLayer );
+                    painter->setOpacity( painterOpacity );
                 }
 
                 // focus animation done
@@ -995,26 +1335,12 @@ namespace Lightly
 
                     const qreal finalRadius ((frameRect.width()+Metrics::Frame_FrameWidth)*opacity);
 
-                    QPixmap mask = QPixmap(rect.width(), rect.height());
-                    mask.fill( Qt::transparent );
-
-                    QPainter pmask( &mask );
-                    pmask.setOpacity(1);
-                    pmask.setRenderHint( QPainter::Antialiasing );
-                    pmask.fillRect(rect, Qt::black);
-                    pmask.setPen( Qt::NoPen );
-                    pmask.setBrush( Qt::black );
-                    pmask.setCompositionMode(QPainter::CompositionMode_SourceOut);
-                    pmask.drawEllipse(QPointF(frameRect.x(), frameRect.y() + frameRect.height()/2), finalRadius, finalRadius);
-                    pmask.end();
-
-                    QPixmap pixmap = QPixmap(rect.width(), rect.height());
-                    pixmap.fill( Qt::transparent );
-                    QPainter p( &pixmap );
-                    //p.setOpacity(0.3 + 0.6*opacity);
+                    // same reveal as the focus in animation, shrinking
+                    const QRect layerRect( rect.adjusted( -s_focusRevealMargin, -s_focusRevealMargin, s_focusRevealMargin, s_focusRevealMargin ) );
+                    QPainter p( &focusRevealLayer( layerRect.size(), painter->device() ? painter->device()->devicePixelRatioF() : qApp->devicePixelRatio() ) );
                     p.setRenderHint( QPainter::Antialiasing );
-                    p.setCompositionMode(QPainter::CompositionMode_SourceOver);
-                    p.setPen(Qt::NoPen);
+                    p.setPen( Qt::NoPen );
+                    p.translate( -layerRect.topLeft() );
                     renderBoxShadow( &p, frameRect, 0, 1, 6, outline.darker(120) , radius, windowActive );
                     renderBoxShadow( &p, frameRect, 0, 1, 4, outline.darker(120) , radius, windowActive );
                     p.setBrush( alphaColor( outline, 0.6 ) ) ;
@@ -1022,11 +1348,12 @@ namespace Lightly
                     p.drawRoundedRect( focusFrame, radius + 1, radius + 1);
 
                     // mask
-                    p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-                    p.drawPixmap(rect, mask);
+                    p.setCompositionMode( QPainter::CompositionMode_DestinationIn );
+                    p.setBrush( Qt::black );
+                    p.drawEllipse( QPointF( frameRect.x(), frameRect.y() + frameRect.height()/2 ), finalRadius, finalRadius );
                     p.end();
 
-                    painter->drawPixmap( rect, pixmap );
+                    painter->drawPixmap( layerRect.topLeft(), _focusRevealLayer );
 
                     // unfocused lineedit shadow effect
                     renderBoxShadow( painter, frameRect, 0, 1, 5, QColor(0,0,0,84*(1-opacity)), radius, windowActive );
@@ -1104,6 +1431,27 @@ namespace Lightly
         bool sunken, const bool mouseOver, CheckBoxState state, const bool windowActive, qreal animation ) const
     {
 
+        animation = state == CheckAnimated ? quantizedAnimation( animation ) : 0;
+        const IndicatorKey key = {
+            0, QSize(), state,
+            mouseOver, sunken, isInMenu, windowActive, isDarkTheme( palette ),
+            palette.color( QPalette::Highlight ).rgba(), palette.color( QPalette::Button ).rgba(), palette.color( QPalette::HighlightedText ).rgba(),
+            qRound( animation*s_indicatorAnimationSteps ), 0
+        };
+
+        // box shadows extend past the frame by their size and offset, plus one pixel for antialiasing
+        const int margin( s_indicatorShadowSize + s_indicatorShadowOffset.manhattanLength() + 1 );
+        renderIndicator( painter, rect, margin, key, [&]( QPainter* target, const QRect& targetRect )
+        { renderCheckBoxIndicator( target, targetRect, palette, isInMenu, sunken, mouseOver, state, windowActive, animation ); } );
+
+    }
+
+    //______________________________________________________________________________
+    void Helper::renderCheckBoxIndicator(
+        QPainter* painter, const QRect& rect, const QPalette& palette, const bool isInMenu,
+        bool sunken, const bool mouseOver, CheckBoxState state, const bool windowActive, qreal animation ) const
+    {
+
         // setup painter
         painter->setRenderHint( QPainter::Antialiasing, true );
         painter->setPen( Qt::NoPen );
@@ -1272,6 +1620,28 @@ namespace Lightly
         bool sunken, RadioButtonState state, const bool isInMenu, qreal animation ) const
     {
 
+        animation = state == RadioAnimated ? quantizedAnimation( animation ) : 0;
+        const IndicatorKey key = {
+            1, QSize(), state,
+            mouseOver, sunken, isInMenu, false, isDarkTheme( palette ),
+            palette.color( QPalette::Highlight ).rgba(), palette.color( QPalette::Button ).rgba(), palette.color( QPalette::HighlightedText ).rgba(),
+            qRound( animation*s_indicatorAnimationSteps ), 0
+        };
+
+        // the fading shadow is shifted by one pixel, and the outline adds another one
+        const int margin( ellipseShadowMargin( s_indicatorShadowSize, s_indicatorShadowOffset ) + 2 );
+        renderIndicator( painter, rect, margin, key, [&]( QPainter* target, const QRect& targetRect )
+        { renderRadioButtonIndicator( target, targetRect, palette, mouseOver, sunken, state, isInMenu, animation ); } );
+
+    }
+
+    //______________________________________________________________________________
+    void Helper::renderRadioButtonIndicator(
+        QPainter* painter, const QRect& rect,
+        const QPalette& palette, const bool mouseOver,
+        bool sunken, RadioButtonState state, const bool isInMenu, qreal animation ) const
+    {
+
         // setup painter
         painter->setRenderHint( QPainter::Antialiasing, true );
         painter->setPen( Qt::NoPen );
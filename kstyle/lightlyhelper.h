@@ -31,6 +31,7 @@
 #include <KColorScheme>
 #include <KSharedConfig>
 
+#include <QCache>
 #include <QPainterPath>
 #include <QIcon>
 #include <QWidget>
@@ -318,6 +319,21 @@ namespace Lightly
         //* return rounded path in a given rect, with only selected corners rounded, and for a given radius
         QPainterPath roundedPath( const QRectF&, Corners, qreal ) const;
 
+        //* render a checkbox directly, without going through the sprite cache
+        void renderCheckBoxIndicator( QPainter*, const QRect&, const QPalette&, const bool isInMenu, bool sunken, const bool mouseOver, CheckBoxState state, const bool windowActive, qreal animation ) const;
+
+        //* render a radio button directly, without going through the sprite cache
+        void renderRadioButtonIndicator( QPainter*, const QRect&, const QPalette&, const bool mouseOver, bool sunken, RadioButtonState state, const bool isInMenu, qreal animation ) const;
+
+        //* render the static part of a button frame (shadow, content and top highlight)
+        void renderButtonFrameContents( QPainter*, const QRectF& frameRect, const QColor& fill, const int shadowSize, const QColor& shadowColor, const bool highlight, const qreal radius ) const;
+
+        //* render the static part of a button frame from cached tiles
+        void renderButtonFrameTiles( QPainter*, const QRect& frameRect, const QColor& fill, int shadowSize, const QColor& shadowColor, const bool highlight, const qreal radius ) const;
+
+        //* transparent layer of the given size for the line edit focus reveal, reused across animation frames
+        QPixmap& focusRevealLayer( const QSize&, qreal dpr ) const;
+
         private:
 
         //* configuration
@@ -339,6 +355,47 @@ namespace Lightly
         QColor _inactiveTitleBarTextColor;
         //@}
 
+        //* top highlight sprites, keyed on color, device pixel ratio and radius
+        mutable QCache<quint64, QPixmap> _topHighlightCache;
+
+        //* button frame tiles cache key
+        struct ButtonFrameKey
+        {
+            QRgb fill;
+            bool hasFill;
+            int shadowSize;
+            QRgb shadowColor;
+            bool highlight;
+            int radius;
+            int dpr;
+
+            bool operator==( const ButtonFrameKey& other ) const
+            {
+                return fill == other.fill && hasFill == other.hasFill
+                    && shadowSize == other.shadowSize && shadowColor == other.shadowColor
+                    && highlight == other.highlight
+                    && radius == other.radius && dpr == other.dpr;
+            }
+
+            friend uint qHash( const ButtonFrameKey& key, uint seed = 0 )
+            {
+                seed = ::qHash( key.fill, seed );
+                seed = ::qHash( key.hasFill, seed );
+                seed = ::qHash( key.shadowSize, seed );
+                seed = ::qHash( key.shadowColor, seed );
+                seed = ::qHash( key.highlight, seed );
+                seed = ::qHash( key.radius, seed );
+                return ::qHash( key.dpr, seed );
+            }
+        };
+
+        //* button frame tiles, one per color scheme, steady button state and device pixel ratio
+        /** corner radius and shadow settings are not part of the key, the cache is flushed when they change */
+        mutable QCache<ButtonFrameKey, TileSet> _buttonFrameCache;
+
+        //* line edit focus reveal layer
+        mutable QPixmap _focusRevealLayer;
+
     };
 
 }
@@ -29,6 +29,7 @@
 #include <QDockWidget>
 #include <QEvent>
 #include <QApplication>
+#include <QCache>
 #include <QMenu>
 #include <QPainter>
 #include <QPixmap>
@@ -69,6 +70,54 @@ namespace
             ShadowParams(QPoint(0, -16), 20, 0.20),
             ShadowParams(QPoint(0, -27), 5, 0.24))
     };
+
+    //* custom shadow tiles cache key
+    struct ShadowTilesKey
+    {
+        int frameRadius;
+        QPoint offset1;
+        int radius1;
+        QRgb color1;
+        QPoint offset2;
+        int radius2;
+        QRgb color2;
+        qreal dpr;
+    };
+
+    inline bool operator==( const ShadowTilesKey& lhs, const ShadowTilesKey& rhs )
+    {
+        return lhs.frameRadius == rhs.frameRadius
+            && lhs.offset1 == rhs.offset1 && lhs.radius1 == rhs.radius1 && lhs.color1 == rhs.color1
+            && lhs.offset2 == rhs.offset2 && lhs.radius2 == rhs.radius2 && lhs.color2 == rhs.color2
+            && qFuzzyCompare( lhs.dpr, rhs.dpr );
+    }
+
+    inline uint qHash( const ShadowTilesKey& key, uint seed = 0 )
+    {
+        uint hash = ::qHash( key.frameRadius, seed );
+        auto combine = [&hash]( uint value ) { hash ^= value + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 ); };
+        combine( ::qHash( key.offset1.x() ) );
+        combine( ::qHash( key.offset1.y() ) );
+        combine( ::qHash( key.radius1 ) );
+        combine( ::qHash( key.color1 ) );
+        combine( ::qHash( key.offset2.x() ) );
+        combine( ::qHash( key.offset2.y() ) );
+        combine( ::qHash( key.radius2 ) );
+        combine( ::qHash( key.color2 ) );
+        combine( ::qHash( qRound( key.dpr*100 ) ) );
+        return hash;
+    }
+
+    //* maximum number of custom shadow tilesets kept around
+    /** widgets use a small set of shadow parameters, so this is never reached in practice, except for animated colors */
+    const int s_shadowTilesCacheSize = 256;
+
+    //* custom shadow tiles cache, least recently used entries are evicted first
+    using ShadowTilesCache = QCache<ShadowTilesKey, Lightly::TileSet>;
+    Q_GLOBAL_STATIC_WITH_ARGS( ShadowTilesCache, s_shadowTilesCache, ( s_shadowTilesCacheSize ) )
+
+    //* custom shadow tiles cache statistics
+    Lightly::ShadowHelper::ShadowTilesCacheStats s_shadowTilesCacheStats;
 }
 
 namespace Lightly
@@ -107,6 +156,9 @@ namespace Lightly
     ShadowHelper::~ShadowHelper()
     {
         qDeleteAll( _shadows );
+
+        // cached pixmaps must not outlive the application
+        clearShadowTilesCache();
     }
 
     //______________________________________________
@@ -237,6 +289,7 @@ namespace Lightly
         shadowRenderer.setBorderRadius(frameRadius);
         shadowRenderer.setBoxSize(boxSize);
         shadowRenderer.setDevicePixelRatio(dpr);
+        shadowRenderer.setPersistentCacheEnabled(true);
 
         shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
             withOpacity(color, params.shadow1.opacity * strength));
@@ -245,12 +298,18 @@ namespace Lightly
         shadowRenderer.addShadow(params.shadow3.offset, params.shadow3.radius,
             withOpacity(color, params.shadow3.opacity * strength));
 
-        QImage shadowTexture = shadowRenderer.render();
+        // The frame is masked out and outlined below, offset from the box.
+        const QMargins frameMargins(
+            Metrics::Shadow_Overlap + params.offset.x(),
+            Metrics::Shadow_Overlap + params.offset.y(),
+            Metrics::Shadow_Overlap - params.offset.x(),
+            Metrics::Shadow_Overlap - params.offset.y());
 
-        const QRect outerRect(QPoint(0, 0), shadowTexture.size() / dpr);
+        const BoxShadowRenderer::Tiles tiles = shadowRenderer.renderTiles(frameMargins);
+        QImage shadowTexture = tiles.image;
 
-        QRect boxRect(QPoint(0, 0), boxSize);
-        boxRect.moveCenter(outerRect.center());
+        const QRect outerRect(QPoint(0, 0), shadowTexture.size() / dpr);
+        const QRect &boxRect = tiles.boxRect;
 
         // Mask out inner rect.
         QPainter painter(&shadowTexture);
@@ -298,7 +357,41 @@ namespace Lightly
 
         if (shadow1.radius == 0) {
             return TileSet();
-        } 
+        }
+
+        const ShadowTilesKey key = {
+            frameRadius,
+            shadow1.offset, shadow1.radius, shadow1.color.rgba(),
+            shadow2.offset, shadow2.radius, shadow2.color.rgba(),
+            qApp->devicePixelRatio()
+        };
+
+        if( const TileSet* cached = s_shadowTilesCache->object( key ) )
+        {
+            ++s_shadowTilesCacheStats.hits;
+            return *cached;
+        }
+
+        ++s_shadowTilesCacheStats.misses;
+        const TileSet tiles( renderShadowTiles( frameRadius, shadow1, shadow2 ) );
+        s_shadowTilesCache->insert( key, new TileSet( tiles ) );
+        return tiles;
+    }
+
+    //_______________________________________________________
+    ShadowHelper::ShadowTilesCacheStats ShadowHelper::shadowTilesCacheStats()
+    { return s_shadowTilesCacheStats; }
+
+    //_______________________________________________________
+    void ShadowHelper::clearShadowTilesCache()
+    {
+        if( s_shadowTilesCache.exists() ) s_shadowTilesCache->clear();
+        s_shadowTilesCacheStats = ShadowTilesCacheStats();
+    }
+
+    //_______________________________________________________
+    TileSet ShadowHelper::renderShadowTiles( const int frameRadius, const CustomShadowParams& shadow1, const CustomShadowParams& shadow2 )
+    {
 
         auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
             QColor c(color);
@@ -323,12 +416,15 @@ namespace Lightly
         if (shadow2.radius > 0) 
             shadowRenderer.addShadow(shadow2.offset, shadow2.radius, shadow2.color);
 
-        QImage shadowTexture = shadowRenderer.render();
+        const QMargins frameMargins(
+            Metrics::Shadow_Overlap, Metrics::Shadow_Overlap,
+            Metrics::Shadow_Overlap, Metrics::Shadow_Overlap);
 
-        const QRect outerRect(QPoint(0, 0), shadowTexture.size() / dpr);
+        const BoxShadowRenderer::Tiles tiles = shadowRenderer.renderTiles(frameMargins);
+        QImage shadowTexture = tiles.image;
 
-        QRect boxRect(QPoint(0, 0), boxSize);
-        boxRect.moveCenter(outerRect.center());
+        const QRect outerRect(QPoint(0, 0), shadowTexture.size() / dpr);
+        const QRect &boxRect = tiles.boxRect;
 
         // Mask out inner rect.
         if( qMax(shadow1.radius, shadow2.radius) > 3 && frameRadius > 3) {
@@ -127,6 +127,19 @@ namespace Lightly
         TileSet shadowTiles();
         static TileSet shadowTiles( const int frameRadius, CustomShadowParams shadow1, CustomShadowParams shadow2 = CustomShadowParams() );
 
+        //* custom shadow tiles cache statistics
+        struct ShadowTilesCacheStats
+        {
+            int hits = 0;
+            int misses = 0;
+        };
+
+        //* custom shadow tiles cache statistics
+        static ShadowTilesCacheStats shadowTilesCacheStats();
+
+        //* clear custom shadow tiles cache
+        static void clearShadowTilesCache();
+
         protected Q_SLOTS:
 
         //* unregister widget
@@ -167,6 +180,9 @@ namespace Lightly
         //* gets the shadow margins for the given widget
         QMargins shadowMargins( QWidget* ) const;
 
+        //* render custom shadow tiles, bypassing the cache
+        static TileSet renderShadowTiles( const int frameRadius, const CustomShadowParams& shadow1, const CustomShadowParams& shadow2 );
+
         private:
 
         //* helper
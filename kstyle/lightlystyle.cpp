@@ -1774,6 +1774,7 @@ namespace Lightly
 
         // reset shadow tiles
         _shadowHelper->loadConfig();
+        ShadowHelper::clearShadowTilesCache();
 
         // set mdiwindow factory shadow tiles
         _mdiWindowShadowFactory->setShadowHelper( _shadowHelper );
@@ -0,0 +1,247 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyboxblur.h"
+#include "lightlyboxblur_p.h"
+
+// Qt
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <cstring>
+
+using namespace Lightly;
+
+namespace
+{
+
+const int s_blurRadii[] = { 2, 3, 5, 8, 13, 24, 32, 64, 100 };
+
+// None of these is a multiple of the lane count.
+const int s_rowLengths[] = { 7, 9, 15, 17, 31, 33, 63, 65, 100, 257 };
+
+// Images below and above the size at which boxBlurAlpha splits the work
+// between threads.
+const QSize s_imageSizes[] = { QSize(33, 41), QSize(130, 131), QSize(257, 129) };
+
+/**
+ * The largest of the three box filters used for a given blur radius.
+ **/
+int maximumBoxSize(int radius)
+{
+    int boxSize = 0;
+    for (const BoxLobes &lobes : computeLobes(radius)) {
+        boxSize = qMax(boxSize, lobes.left + 1 + lobes.right);
+    }
+    return boxSize;
+}
+
+QVector<uint8_t> randomAlpha(int count, quint32 seed)
+{
+    QRandomGenerator generator(seed);
+    QVector<uint8_t> values(count);
+    for (uint8_t &value : values) {
+        value = generator.bounded(256);
+    }
+    return values;
+}
+
+/**
+ * Blur alpha values the way boxBlurAlpha does, with the scalar box filter only.
+ **/
+QVector<uint8_t> referenceBlur(QVector<uint8_t> values, int width, int height, int radius)
+{
+    const QVector<BoxLobes> lobes = computeLobes(radius);
+    const int length = qMax(width, height);
+    QVector<uint8_t> line(length);
+    QVector<uint8_t> buf1(length);
+    QVector<uint8_t> buf2(length);
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t *row = values.data() + y * width;
+        boxBlurRowAlphaScalar(row, buf1.data(), width, lobes[0]);
+        boxBlurRowAlphaScalar(buf1.data(), buf2.data(), width, lobes[1]);
+        boxBlurRowAlphaScalar(buf2.data(), row, width, lobes[2]);
+    }
+
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+            line[y] = values[y * width + x];
+        }
+        boxBlurRowAlphaScalar(line.data(), buf1.data(), height, lobes[0]);
+        boxBlurRowAlphaScalar(buf1.data(), buf2.data(), height, lobes[1]);
+        boxBlurRowAlphaScalar(buf2.data(), line.data(), height, lobes[2]);
+        for (int y = 0; y < height; ++y) {
+            values[y * width + x] = line[y];
+        }
+    }
+
+    return values;
+}
+
+}
+
+class LightlyBoxBlurTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void lanesKernel_data();
+    void lanesKernel();
+    void boxBlurAlpha_data();
+    void boxBlurAlpha();
+};
+
+void LightlyBoxBlurTest::lanesKernel_data()
+{
+    QTest::addColumn<int>("kernel");
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<int>("length");
+
+    const QVector<BoxBlurLanesKernel> kernels = supportedBoxBlurLanesKernels();
+    if (kernels.isEmpty()) {
+        QTest::newRow("scalar") << -1 << 0 << 0;
+        return;
+    }
+
+    for (int kernel = 0; kernel < kernels.count(); ++kernel) {
+        for (int radius : s_blurRadii) {
+            for (int length : s_rowLengths) {
+                // The scalar box filter does not support rows shorter than the box.
+                if (maximumBoxSize(radius) > length) {
+                    continue;
+                }
+
+                const QByteArray name = QByteArray(kernels.at(kernel).name)
+                    + "-radius" + QByteArray::number(radius)
+                    + "-length" + QByteArray::number(length);
+                QTest::newRow(name.constData()) << kernel << radius << length;
+            }
+        }
+    }
+}
+
+void LightlyBoxBlurTest::lanesKernel()
+{
+    QFETCH(int, kernel);
+    QFETCH(int, radius);
+    QFETCH(int, length);
+
+    if (kernel < 0) {
+        QSKIP("The running CPU has no vectorized box filter");
+    }
+
+    const BoxBlurLanesFunc boxBlurLanes = supportedBoxBlurLanesKernels().at(kernel).run;
+    const QVector<uint8_t> rows = randomAlpha(s_laneCount * length, radius * 1000 + length);
+
+    QVector<uint32_t> src(s_laneCount * length);
+    for (int lane = 0; lane < s_laneCount; ++lane) {
+        for (int i = 0; i < length; ++i) {
+            src[i * s_laneCount + lane] = rows[lane * length + i];
+        }
+    }
+
+    for (const BoxLobes &lobes : computeLobes(radius)) {
+        QVector<uint32_t> dst(s_laneCount * length);
+        boxBlurLanes(src.constData(), dst.data(), length, lobes);
+
+        for (int lane = 0; lane < s_laneCount; ++lane) {
+            QVector<uint8_t> expected(length);
+            boxBlurRowAlphaScalar(rows.constData() + lane * length, expected.data(), length, lobes);
+
+            QVector<uint8_t> actual(length);
+            for (int i = 0; i < length; ++i) {
+                actual[i] = dst[i * s_laneCount + lane];
+            }
+
+            QCOMPARE(actual, expected);
+        }
+    }
+}
+
+void LightlyBoxBlurTest::boxBlurAlpha_data()
+{
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("layout");
+
+    for (int radius : s_blurRadii) {
+        for (const QSize &size : s_imageSizes) {
+            if (maximumBoxSize(radius) > qMin(size.width(), size.height())) {
+                continue;
+            }
+
+            for (QImage::Format format : { QImage::Format_Alpha8, QImage::Format_ARGB32_Premultiplied }) {
+                for (BoxBlurColumnLayout layout : { BoxBlurColumnLayout::Blocked, BoxBlurColumnLayout::Strided }) {
+                    const QByteArray name = "radius" + QByteArray::number(radius)
+                        + "-" + QByteArray::number(size.width()) + "x" + QByteArray::number(size.height())
+                        + (format == QImage::Format_Alpha8 ? "-alpha8" : "-argb32")
+                        + (layout == BoxBlurColumnLayout::Blocked ? "-blocked" : "-strided");
+                    QTest::newRow(name.constData()) << radius << size << int(format) << int(layout);
+                }
+            }
+        }
+    }
+}
+
+void LightlyBoxBlurTest::boxBlurAlpha()
+{
+    QFETCH(int, radius);
+    QFETCH(QSize, size);
+    QFETCH(int, format);
+    QFETCH(int, layout);
+
+    // boxBlurAlpha dispatches to the vectorized box filter for groups of
+    // lanes, leaves the remainder to the scalar one, splits big images into
+    // bands, and transposes blocks of columns; none of this may change the
+    // result.
+    QImage image(size, static_cast<QImage::Format>(format));
+    const int bytesPerRow = size.width() * image.depth() / 8;
+    for (int y = 0; y < size.height(); ++y) {
+        const QVector<uint8_t> bytes = randomAlpha(bytesPerRow, radius * 1000 + y);
+        memcpy(image.scanLine(y), bytes.constData(), bytesPerRow);
+    }
+
+    QVector<uint8_t> values(size.width() * size.height());
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            values[y * size.width() + x] = qAlpha(image.pixel(x, y));
+        }
+    }
+
+    const QVector<uint8_t> expected = referenceBlur(values, size.width(), size.height(), radius);
+    if (static_cast<BoxBlurColumnLayout>(layout) == BoxBlurColumnLayout::Blocked) {
+        Lightly::boxBlurAlpha(image, radius);
+    } else {
+        Lightly::boxBlurAlpha(image, radius, BoxBlurColumnLayout::Strided);
+    }
+
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            const int actual = qAlpha(image.pixel(x, y));
+            if (actual != expected[y * size.width() + x]) {
+                QFAIL(qPrintable(QStringLiteral("alpha at (%1, %2) is %3, expected %4")
+                    .arg(x).arg(y).arg(actual).arg(expected[y * size.width() + x])));
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(LightlyBoxBlurTest)
+
+#include "lightlyboxblurtest.moc"
@@ -0,0 +1,359 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyboxshadowrenderer.h"
+
+// Qt
+#include <QTest>
+
+using namespace Lightly;
+
+namespace
+{
+
+struct ShadowParams
+{
+    QPoint offset;
+    int radius;
+    qreal opacity;
+};
+
+struct ShadowPreset
+{
+    const char *name;
+    QVector<ShadowParams> shadows;
+};
+
+// Keep in sync with s_shadowParams in kdecoration/lightlydecoration.cpp.
+const ShadowPreset s_decorationPresets[] = {
+    { "Small", { { QPoint(0, 0), 16, 1 }, { QPoint(0, -2), 8, 0.4 } } },
+    { "Medium", { { QPoint(0, 0), 32, 0.9 }, { QPoint(0, -4), 16, 0.3 } } },
+    { "Large", { { QPoint(0, 0), 48, 0.8 }, { QPoint(0, -6), 24, 0.2 } } },
+    { "VeryLarge", { { QPoint(0, 0), 64, 0.7 }, { QPoint(0, -8), 32, 0.1 } } },
+};
+
+// Keep in sync with s_shadowParams in kstyle/lightlyshadowhelper.cpp.
+const ShadowPreset s_stylePresets[] = {
+    { "Small", { { QPoint(0, 0), 8, 0.8 }, { QPoint(0, -4), 4, 0.16 }, { QPoint(0, -6), 2, 0.12 } } },
+    { "Medium", { { QPoint(0, 0), 20, 0.24 }, { QPoint(0, -4), 8, 0.32 }, { QPoint(0, -6), 4, 0.01 } } },
+    { "Large", { { QPoint(0, 0), 28, 0.20 }, { QPoint(0, -8), 16, 0.24 }, { QPoint(0, -13), 6, 0.16 } } },
+    { "VeryLarge", { { QPoint(0, 0), 40, 0.12 }, { QPoint(0, -16), 20, 0.20 }, { QPoint(0, -27), 5, 0.24 } } },
+};
+
+const int s_blurRadii[] = { 2, 3, 4, 5, 8, 13, 16, 24, 32, 48, 64 };
+
+const qreal s_cornerRadii[] = { 0, 3, 6, 12 };
+
+const qreal s_devicePixelRatios[] = { 1, 1.25, 1.5, 2 };
+
+// Frames as the kstyle and kdecoration shadows mask out, offset from the box.
+const QMargins s_frameMargins[] = { QMargins(), QMargins(3, 11, 3, -5), QMargins(2, 34, 2, -30) };
+
+const int s_frameMarginsCount = 3;
+
+/**
+ * The largest difference, in any channel, allowed between the two backends.
+ *
+ * Besides the difference between a Gaussian and three box filters, the box
+ * blur backend sees the box through antialiased rasterization. Both add up
+ * the most for small blur radii at fractional device pixel ratios.
+ **/
+const int s_maximumError = 8;
+
+/**
+ * Render a shadow with a given backend.
+ **/
+QImage renderShadow(const QVector<ShadowParams> &shadows, qreal cornerRadius, qreal dpr,
+                    BoxShadowRenderer::Backend backend)
+{
+    QSize boxSize;
+    for (const ShadowParams &shadow : shadows) {
+        boxSize = boxSize.expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(shadow.radius));
+    }
+
+    BoxShadowRenderer shadowRenderer;
+    shadowRenderer.setBorderRadius(cornerRadius);
+    shadowRenderer.setBoxSize(boxSize);
+    shadowRenderer.setDevicePixelRatio(dpr);
+    shadowRenderer.setBackend(backend);
+
+    for (const ShadowParams &shadow : shadows) {
+        QColor color(Qt::black);
+        color.setAlphaF(shadow.opacity);
+        shadowRenderer.addShadow(shadow.offset, shadow.radius, color);
+    }
+
+    return shadowRenderer.render();
+}
+
+}
+
+Q_DECLARE_METATYPE(QVector<ShadowParams>)
+
+class LightlyBoxShadowRendererTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void analyticBackend_data();
+    void analyticBackend();
+    void renderTiles_data();
+    void renderTiles();
+    void minimumBoxSize_data();
+    void minimumBoxSize();
+};
+
+void LightlyBoxShadowRendererTest::analyticBackend_data()
+{
+    QTest::addColumn<QVector<ShadowParams>>("shadows");
+    QTest::addColumn<qreal>("cornerRadius");
+    QTest::addColumn<qreal>("dpr");
+
+    const auto addRows = [](const QByteArray &name, const QVector<ShadowParams> &shadows) {
+        for (qreal cornerRadius : s_cornerRadii) {
+            for (qreal dpr : s_devicePixelRatios) {
+                const QByteArray rowName = name
+                    + "-corner" + QByteArray::number(cornerRadius)
+                    + "-dpr" + QByteArray::number(dpr);
+                QTest::newRow(rowName.constData()) << shadows << cornerRadius << dpr;
+            }
+        }
+    };
+
+    for (const ShadowPreset &preset : s_decorationPresets) {
+        addRows(QByteArray("kdecoration-") + preset.name, preset.shadows);
+    }
+
+    for (const ShadowPreset &preset : s_stylePresets) {
+        addRows(QByteArray("kstyle-") + preset.name, preset.shadows);
+    }
+
+    for (int radius : s_blurRadii) {
+        addRows("radius" + QByteArray::number(radius), { { QPoint(0, 0), radius, 1 } });
+    }
+}
+
+void LightlyBoxShadowRendererTest::analyticBackend()
+{
+    QFETCH(QVector<ShadowParams>, shadows);
+    QFETCH(qreal, cornerRadius);
+    QFETCH(qreal, dpr);
+
+    const QImage expected = renderShadow(shadows, cornerRadius, dpr, BoxShadowRenderer::Backend::BoxBlur);
+    const QImage actual = renderShadow(shadows, cornerRadius, dpr, BoxShadowRenderer::Backend::Analytic);
+
+    QCOMPARE(actual.size(), expected.size());
+    QCOMPARE(actual.format(), expected.format());
+
+    int maximumError = 0;
+    QPoint worstPixel;
+    for (int y = 0; y < actual.height(); ++y) {
+        const QRgb *actualRow = reinterpret_cast<const QRgb *>(actual.constScanLine(y));
+        const QRgb *expectedRow = reinterpret_cast<const QRgb *>(expected.constScanLine(y));
+        for (int x = 0; x < actual.width(); ++x) {
+            const int error = qMax(
+                qMax(qAbs(qRed(actualRow[x]) - qRed(expectedRow[x])), qAbs(qGreen(actualRow[x]) - qGreen(expectedRow[x]))),
+                qMax(qAbs(qBlue(actualRow[x]) - qBlue(expectedRow[x])), qAbs(qAlpha(actualRow[x]) - qAlpha(expectedRow[x]))));
+            if (error > maximumError) {
+                maximumError = error;
+                worstPixel = QPoint(x, y);
+            }
+        }
+    }
+
+    if (maximumError > s_maximumError) {
+        QFAIL(qPrintable(QStringLiteral("error at (%1, %2) is %3/255, expected at most %4/255")
+            .arg(worstPixel.x()).arg(worstPixel.y()).arg(maximumError).arg(s_maximumError)));
+    }
+}
+
+void LightlyBoxShadowRendererTest::renderTiles_data()
+{
+    QTest::addColumn<QVector<ShadowParams>>("shadows");
+    QTest::addColumn<int>("boxGrowth");
+    QTest::addColumn<qreal>("cornerRadius");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<int>("frame");
+
+    for (const ShadowPreset &preset : s_stylePresets) {
+        for (int boxGrowth : { 0, 40, 200 }) {
+            for (qreal cornerRadius : s_cornerRadii) {
+                // The middle logical pixel of the texture only maps to whole
+                // device pixels at integer device pixel ratios.
+                for (qreal dpr : { 1.0, 2.0 }) {
+                    for (int frame = 0; frame < s_frameMarginsCount; ++frame) {
+                        const QByteArray name = QByteArray(preset.name)
+                            + "-box" + QByteArray::number(boxGrowth)
+                            + "-corner" + QByteArray::number(cornerRadius)
+                            + "-dpr" + QByteArray::number(dpr)
+                            + "-frame" + QByteArray::number(frame);
+                        QTest::newRow(name.constData()) << preset.shadows << boxGrowth << cornerRadius << dpr << frame;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightlyBoxShadowRendererTest::renderTiles()
+{
+    QFETCH(QVector<ShadowParams>, shadows);
+    QFETCH(int, boxGrowth);
+    QFETCH(qreal, cornerRadius);
+    QFETCH(qreal, dpr);
+    QFETCH(int, frame);
+
+    QSize boxSize;
+    for (const ShadowParams &shadow : shadows) {
+        boxSize = boxSize.expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(shadow.radius));
+    }
+    boxSize += QSize(boxGrowth, boxGrowth);
+
+    BoxShadowRenderer shadowRenderer;
+    shadowRenderer.setBorderRadius(cornerRadius);
+    shadowRenderer.setBoxSize(boxSize);
+    shadowRenderer.setDevicePixelRatio(dpr);
+
+    for (const ShadowParams &shadow : shadows) {
+        QColor color(Qt::black);
+        color.setAlphaF(shadow.opacity);
+        shadowRenderer.addShadow(shadow.offset, shadow.radius, color);
+    }
+
+    const QImage texture = shadowRenderer.render();
+    const BoxShadowRenderer::Tiles tiles = shadowRenderer.renderTiles(s_frameMargins[frame]);
+
+    const int scale = qRound(dpr);
+    const QSize logicalSize = tiles.image.size() / scale;
+    const QSize textureLogicalSize = texture.size() / scale;
+    if (boxGrowth >= 200) {
+        QVERIFY(logicalSize.width() < textureLogicalSize.width());
+        QVERIFY(logicalSize.height() < textureLogicalSize.height());
+    }
+
+    // A collapsed texture has as many pixels on both sides of its middle one.
+    if (logicalSize.width() < textureLogicalSize.width()) {
+        QCOMPARE(logicalSize.width() % 2, 1);
+    }
+    if (logicalSize.height() < textureLogicalSize.height()) {
+        QCOMPARE(logicalSize.height() % 2, 1);
+    }
+
+    QRect boxRect(QPoint(0, 0), boxSize);
+    boxRect.moveCenter(QRect(QPoint(0, 0), textureLogicalSize).center());
+    QCOMPARE(tiles.boxRect.topLeft(), boxRect.topLeft());
+    QCOMPARE(logicalSize.width() - tiles.boxRect.right(), textureLogicalSize.width() - boxRect.right());
+    QCOMPARE(logicalSize.height() - tiles.boxRect.bottom(), textureLogicalSize.height() - boxRect.bottom());
+
+    // Both ends of the texture are kept as is, and stretching the middle
+    // logical pixel fills the rest.
+    const QPoint middle(logicalSize.width() / 2 * scale, logicalSize.height() / 2 * scale);
+    const QPoint removed(texture.width() - tiles.image.width(), texture.height() - tiles.image.height());
+    const auto map = [](int i, int split, int count) {
+        if (i < split) {
+            return i;
+        } else if (i >= split + count) {
+            return i - count;
+        }
+        return split;
+    };
+
+    for (int y = 0; y < texture.height(); ++y) {
+        for (int x = 0; x < texture.width(); ++x) {
+            const QPoint tile(map(x, middle.x(), removed.x()), map(y, middle.y(), removed.y()));
+            if (texture.pixel(x, y) != tiles.image.pixel(tile)) {
+                QFAIL(qPrintable(QStringLiteral("pixel at (%1, %2) is %3, expected %4")
+                    .arg(tile.x()).arg(tile.y()).arg(tiles.image.pixel(tile), 8, 16).arg(texture.pixel(x, y), 8, 16)));
+            }
+        }
+    }
+}
+
+void LightlyBoxShadowRendererTest::minimumBoxSize_data()
+{
+    QTest::addColumn<QVector<ShadowParams>>("shadows");
+    QTest::addColumn<int>("boxGrowth");
+
+    for (int boxGrowth : { 40, 41 }) {
+        for (const ShadowPreset &preset : s_decorationPresets) {
+            const QByteArray name = QByteArray("kdecoration-") + preset.name + "-box" + QByteArray::number(boxGrowth);
+            QTest::newRow(name.constData()) << preset.shadows << boxGrowth;
+        }
+
+        for (const ShadowPreset &preset : s_stylePresets) {
+            const QByteArray name = QByteArray("kstyle-") + preset.name + "-box" + QByteArray::number(boxGrowth);
+            QTest::newRow(name.constData()) << preset.shadows << boxGrowth;
+        }
+    }
+}
+
+void LightlyBoxShadowRendererTest::minimumBoxSize()
+{
+    QFETCH(QVector<ShadowParams>, shadows);
+    QFETCH(int, boxGrowth);
+
+    // The shadow textures of kstyle and kdecoration are rendered around the
+    // minimum box size. Their center pixel is already the only one between
+    // the corners: stretching it gives the texture of any larger box, and
+    // renderTiles() has nothing left to collapse.
+    QSize boxSize;
+    for (const ShadowParams &shadow : shadows) {
+        boxSize = boxSize.expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(shadow.radius));
+    }
+
+    const auto createRenderer = [&shadows](const QSize &size) {
+        BoxShadowRenderer shadowRenderer;
+        shadowRenderer.setBoxSize(size);
+        for (const ShadowParams &shadow : shadows) {
+            QColor color(Qt::black);
+            color.setAlphaF(shadow.opacity);
+            shadowRenderer.addShadow(shadow.offset, shadow.radius, color);
+        }
+        return shadowRenderer;
+    };
+
+    const BoxShadowRenderer minimumRenderer = createRenderer(boxSize);
+    const QImage texture = minimumRenderer.render();
+    QCOMPARE(minimumRenderer.renderTiles().image.size(), texture.size());
+
+    const QImage grownTexture = createRenderer(boxSize + QSize(boxGrowth, boxGrowth)).render();
+    QCOMPARE(grownTexture.size(), texture.size() + QSize(boxGrowth, boxGrowth));
+
+    const QPoint center = texture.rect().center();
+    const auto map = [boxGrowth](int i, int center) {
+        if (i < center) {
+            return i;
+        } else if (i >= center + boxGrowth) {
+            return i - boxGrowth;
+        }
+        return center;
+    };
+
+    for (int y = 0; y < grownTexture.height(); ++y) {
+        for (int x = 0; x < grownTexture.width(); ++x) {
+            const QPoint pixel(map(x, center.x()), map(y, center.y()));
+            if (grownTexture.pixel(x, y) != texture.pixel(pixel)) {
+                QFAIL(qPrintable(QStringLiteral("pixel at (%1, %2) is %3, expected %4")
+                    .arg(pixel.x()).arg(pixel.y()).arg(texture.pixel(pixel), 8, 16).arg(grownTexture.pixel(x, y), 8, 16)));
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(LightlyBoxShadowRendererTest)
+
+#include "lightlyboxshadowrenderertest.moc"
@@ -0,0 +1,130 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyshadowtexturecache.h"
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTest>
+
+using namespace Lightly;
+
+namespace
+{
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/lightly/shadows");
+}
+
+QString cacheFilePath(const QByteArray &key)
+{
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+    return cacheDirectory() + QLatin1Char('/') + QString::fromLatin1(hash);
+}
+
+QImage testTexture()
+{
+    QImage image(37, 29, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(1.5);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = (x * 7 + y * 13) % 256;
+            image.setPixel(x, y, qPremultiply(qRgba(0, 0, 0, alpha)));
+        }
+    }
+    return image;
+}
+
+}
+
+class LightlyShadowTextureCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void storeAndLoad();
+    void otherKey();
+    void truncatedEntry_data();
+    void truncatedEntry();
+};
+
+void LightlyShadowTextureCacheTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void LightlyShadowTextureCacheTest::init()
+{
+    QDir(cacheDirectory()).removeRecursively();
+}
+
+void LightlyShadowTextureCacheTest::storeAndLoad()
+{
+    const QByteArray key("storeAndLoad");
+    const QImage texture = testTexture();
+    ShadowTextureCache::store(key, texture);
+
+    const QImage loaded = ShadowTextureCache::load(key);
+    QCOMPARE(loaded.devicePixelRatio(), texture.devicePixelRatio());
+    QVERIFY(loaded == texture);
+}
+
+void LightlyShadowTextureCacheTest::otherKey()
+{
+    ShadowTextureCache::store("otherKey", testTexture());
+    QVERIFY(ShadowTextureCache::load("otherKey2").isNull());
+
+    // An entry whose file is found under the hash of another key is rejected too.
+    QVERIFY(QFile::copy(cacheFilePath("otherKey"), cacheFilePath("otherKey2")));
+    QVERIFY(ShadowTextureCache::load("otherKey2").isNull());
+}
+
+void LightlyShadowTextureCacheTest::truncatedEntry_data()
+{
+    QTest::addColumn<int>("removedBytes");
+
+    QTest::newRow("one pixel byte") << 1;
+    QTest::newRow("pixels") << 37 * 29 * 4;
+    QTest::newRow("pixels and part of the key") << 37 * 29 * 4 + 40;
+}
+
+void LightlyShadowTextureCacheTest::truncatedEntry()
+{
+    QFETCH(int, removedBytes);
+
+    // A long key, so truncating the file cuts through it.
+    const QByteArray key(256, 'k');
+    ShadowTextureCache::store(key, testTexture());
+    QVERIFY(!ShadowTextureCache::load(key).isNull());
+
+    QFile file(cacheFilePath(key));
+    QVERIFY(file.exists());
+    QVERIFY(file.resize(file.size() - removedBytes));
+
+    QVERIFY(ShadowTextureCache::load(key).isNull());
+}
+
+QTEST_GUILESS_MAIN(LightlyShadowTextureCacheTest)
+
+#include "lightlyshadowtexturecachetest.moc"
@@ -0,0 +1,246 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Run with "-o results.xml,xml" or "-o results.csv,csv" to get machine-readable
+// results, e.g. to compare shadow rendering before and after a change.
+
+// own
+#include "lightlyboxblur.h"
+#include "lightlyboxblur_p.h"
+#include "lightlyboxshadowrenderer.h"
+
+// Qt
+#include <QPainter>
+#include <QTest>
+
+using namespace Lightly;
+
+namespace
+{
+
+struct ShadowParams
+{
+    QPoint offset;
+    int radius;
+    qreal opacity;
+};
+
+struct ShadowPreset
+{
+    const char *name;
+    QVector<ShadowParams> shadows;
+};
+
+// Keep in sync with s_shadowParams in kdecoration/lightlydecoration.cpp.
+const ShadowPreset s_decorationPresets[] = {
+    { "None", {} },
+    { "Small", { { QPoint(0, 0), 16, 1 }, { QPoint(0, -2), 8, 0.4 } } },
+    { "Medium", { { QPoint(0, 0), 32, 0.9 }, { QPoint(0, -4), 16, 0.3 } } },
+    { "Large", { { QPoint(0, 0), 48, 0.8 }, { QPoint(0, -6), 24, 0.2 } } },
+    { "VeryLarge", { { QPoint(0, 0), 64, 0.7 }, { QPoint(0, -8), 32, 0.1 } } },
+};
+
+// Keep in sync with s_shadowParams in kstyle/lightlyshadowhelper.cpp.
+const ShadowPreset s_stylePresets[] = {
+    { "None", {} },
+    { "Small", { { QPoint(0, 0), 8, 0.8 }, { QPoint(0, -4), 4, 0.16 }, { QPoint(0, -6), 2, 0.12 } } },
+    { "Medium", { { QPoint(0, 0), 20, 0.24 }, { QPoint(0, -4), 8, 0.32 }, { QPoint(0, -6), 4, 0.01 } } },
+    { "Large", { { QPoint(0, 0), 28, 0.20 }, { QPoint(0, -8), 16, 0.24 }, { QPoint(0, -13), 6, 0.16 } } },
+    { "VeryLarge", { { QPoint(0, 0), 40, 0.12 }, { QPoint(0, -16), 20, 0.20 }, { QPoint(0, -27), 5, 0.24 } } },
+};
+
+const int s_presetCount = 5;
+
+const qreal s_devicePixelRatios[] = { 1, 1.25, 1.5, 2 };
+
+const qreal s_cornerRadii[] = { 0, 3, 6, 12 };
+
+const int s_blurRadii[] = { 8, 16, 24, 32, 48, 64 };
+
+const qreal s_columnLayoutDevicePixelRatios[] = { 1, 1.5, 2 };
+
+/**
+ * An image laid out as a single layer of a shadow texture.
+ **/
+QImage shadowLayerImage(int radius, qreal dpr, QImage::Format format)
+{
+    const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(radius);
+    const QSize size = BoxShadowRenderer::calculateMinimumShadowTextureSize(boxSize, radius, QPoint());
+
+    QImage image(size * dpr, format);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QRect boxRect(QPoint(0, 0), boxSize);
+    boxRect.moveCenter(QRect(QPoint(0, 0), size).center());
+
+    QPainter painter(&image);
+    painter.fillRect(boxRect, Qt::black);
+    painter.end();
+
+    return image;
+}
+
+}
+
+class LightlyCommonBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void render_data();
+    void render();
+    void boxBlurAlpha_data();
+    void boxBlurAlpha();
+    void boxBlurColumnLayout_data();
+    void boxBlurColumnLayout();
+};
+
+void LightlyCommonBenchmark::render_data()
+{
+    QTest::addColumn<bool>("decoration");
+    QTest::addColumn<int>("preset");
+    QTest::addColumn<qreal>("cornerRadius");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<int>("backend");
+
+    for (bool decoration : { true, false }) {
+        for (int preset = 0; preset < s_presetCount; ++preset) {
+            for (qreal cornerRadius : s_cornerRadii) {
+                for (qreal dpr : s_devicePixelRatios) {
+                    for (int backend : { int(BoxShadowRenderer::Backend::BoxBlur), int(BoxShadowRenderer::Backend::Analytic) }) {
+                        const ShadowPreset &shadowPreset = decoration ? s_decorationPresets[preset] : s_stylePresets[preset];
+                        const QByteArray name = QByteArray(decoration ? "kdecoration" : "kstyle")
+                            + '-' + shadowPreset.name
+                            + "-corner" + QByteArray::number(cornerRadius)
+                            + "-dpr" + QByteArray::number(dpr)
+                            + (backend == int(BoxShadowRenderer::Backend::BoxBlur) ? "-boxblur" : "-analytic");
+                        QTest::newRow(name.constData()) << decoration << preset << cornerRadius << dpr << backend;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightlyCommonBenchmark::render()
+{
+    QFETCH(bool, decoration);
+    QFETCH(int, preset);
+    QFETCH(qreal, cornerRadius);
+    QFETCH(qreal, dpr);
+    QFETCH(int, backend);
+
+    const ShadowPreset &shadowPreset = decoration ? s_decorationPresets[preset] : s_stylePresets[preset];
+
+    QSize boxSize;
+    for (const ShadowParams &shadow : shadowPreset.shadows) {
+        boxSize = boxSize.expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(shadow.radius));
+    }
+
+    BoxShadowRenderer shadowRenderer;
+    shadowRenderer.setBorderRadius(cornerRadius);
+    shadowRenderer.setBoxSize(boxSize);
+    shadowRenderer.setDevicePixelRatio(dpr);
+    shadowRenderer.setBackend(static_cast<BoxShadowRenderer::Backend>(backend));
+
+    for (const ShadowParams &shadow : shadowPreset.shadows) {
+        QColor color(Qt::black);
+        color.setAlphaF(shadow.opacity);
+        shadowRenderer.addShadow(shadow.offset, shadow.radius, color);
+    }
+
+    QBENCHMARK {
+        shadowRenderer.render();
+    }
+}
+
+void LightlyCommonBenchmark::boxBlurAlpha_data()
+{
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<int>("format");
+
+    for (int radius : s_blurRadii) {
+        for (qreal dpr : s_devicePixelRatios) {
+            for (QImage::Format format : { QImage::Format_Alpha8, QImage::Format_ARGB32_Premultiplied }) {
+                const QByteArray name = "radius" + QByteArray::number(radius)
+                    + "-dpr" + QByteArray::number(dpr)
+                    + (format == QImage::Format_Alpha8 ? "-alpha8" : "-argb32");
+                QTest::newRow(name.constData()) << radius << dpr << int(format);
+            }
+        }
+    }
+}
+
+void LightlyCommonBenchmark::boxBlurAlpha()
+{
+    QFETCH(int, radius);
+    QFETCH(qreal, dpr);
+    QFETCH(int, format);
+
+    QImage image = shadowLayerImage(radius, dpr, static_cast<QImage::Format>(format));
+    const int scaledRadius = qRound(radius * dpr);
+
+    // The box blur does the same work whatever the pixels are, so the image
+    // is blurred in place over and over.
+    QBENCHMARK {
+        Lightly::boxBlurAlpha(image, scaledRadius);
+    }
+}
+
+void LightlyCommonBenchmark::boxBlurColumnLayout_data()
+{
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("layout");
+
+    for (int radius : s_blurRadii) {
+        for (qreal dpr : s_columnLayoutDevicePixelRatios) {
+            for (QImage::Format format : { QImage::Format_Alpha8, QImage::Format_ARGB32_Premultiplied }) {
+                for (BoxBlurColumnLayout layout : { BoxBlurColumnLayout::Strided, BoxBlurColumnLayout::Blocked }) {
+                    const QByteArray name = "radius" + QByteArray::number(radius)
+                        + "-dpr" + QByteArray::number(dpr)
+                        + (format == QImage::Format_Alpha8 ? "-alpha8" : "-argb32")
+                        + (layout == BoxBlurColumnLayout::Strided ? "-strided" : "-blocked");
+                    QTest::newRow(name.constData()) << radius << dpr << int(format) << int(layout);
+                }
+            }
+        }
+    }
+}
+
+void LightlyCommonBenchmark::boxBlurColumnLayout()
+{
+    QFETCH(int, radius);
+    QFETCH(qreal, dpr);
+    QFETCH(int, format);
+    QFETCH(int, layout);
+
+    QImage image = shadowLayerImage(radius, dpr, static_cast<QImage::Format>(format));
+    const int scaledRadius = qRound(radius * dpr);
+
+    // Both layouts share the horizontal pass, so the difference between the
+    // two rows of a given radius is the cost of the vertical pass.
+    QBENCHMARK {
+        Lightly::boxBlurAlpha(image, scaledRadius, static_cast<BoxBlurColumnLayout>(layout));
+    }
+}
+
+QTEST_GUILESS_MAIN(LightlyCommonBenchmark)
+
+#include "lightlycommonbenchmark.moc"
@@ -0,0 +1,605 @@
+/*
+ * Copyright (C) 2018 Vlad Zahorodnii <vlad.zahorodnii@kde.org>
+ *
+ * The box blur implementation is based on AlphaBoxBlur from Firefox.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyboxblur.h"
+#include "lightlyboxblur_p.h"
+#include "lightlyworkerpool.h"
+
+// Qt
+#include <QScopedPointer>
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define LIGHTLY_HAVE_BOXBLUR_SIMD 1
+#include <immintrin.h>
+#else
+#define LIGHTLY_HAVE_BOXBLUR_SIMD 0
+#endif
+
+namespace Lightly
+{
+
+/**
+ * Offset of the alpha channel within a pixel, in bytes.
+ *
+ * @param image An ARGB32 or Alpha8 image.
+ **/
+static inline int alphaChannelOffset(const QImage &image)
+{
+    if (image.format() == QImage::Format_Alpha8) {
+        return 0;
+    }
+    return QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
+}
+
+QVector<BoxLobes> computeLobes(int radius)
+{
+    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
+    const int z = blurRadius / 3;
+
+    int major;
+    int minor;
+    int final;
+
+    switch (blurRadius % 3) {
+    case 0:
+        major = z;
+        minor = z;
+        final = z;
+        break;
+
+    case 1:
+        major = z + 1;
+        minor = z;
+        final = z;
+        break;
+
+    case 2:
+        major = z + 1;
+        minor = z;
+        final = z + 1;
+        break;
+
+    default:
+        Q_UNREACHABLE();
+    }
+
+    Q_ASSERT(major + minor + final == blurRadius);
+
+    return {
+        {major, minor},
+        {minor, major},
+        {final, final}
+    };
+}
+
+/**
+ * Process a row with a box filter.
+ *
+ * @param src The start of the row.
+ * @param dst The destination.
+ * @param width The width of the row, in pixels.
+ * @param horizontalStride The number of bytes from one alpha value to the
+ *    next alpha value.
+ * @param verticalStride The number of bytes from one row to the next row.
+ * @param lobes Params of the box filter.
+ * @param transposeInput Whether the input is transposed.
+ * @param transposeOutput Whether the output should be transposed.
+ **/
+static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width, int horizontalStride,
+                                   int verticalStride, const BoxLobes &lobes, bool transposeInput,
+                                   bool transposeOutput)
+{
+    const int inputStep = transposeInput ? verticalStride : horizontalStride;
+    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
+
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const int reciprocal = (1 << 24) / boxSize;
+
+    uint32_t alphaSum = (boxSize + 1) / 2;
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    const uint8_t firstValue = src[0];
+    const uint8_t lastValue = src[(width - 1) * inputStep];
+
+    alphaSum += firstValue * lobes.left;
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
+    while (right < initEnd) {
+        alphaSum += *right;
+        right += inputStep;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * inputStep;
+    while (right < leftEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - firstValue;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *centerEnd = src + width * inputStep;
+    while (right < centerEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - *left;
+        left += inputStep;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *rightEnd = dst + width * outputStep;
+    while (out < rightEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += lastValue - *left;
+        left += inputStep;
+        out += outputStep;
+    }
+}
+
+/**
+ * Size of a cache line, in bytes. The vertical pass of boxBlurAlpha
+ * transposes as many columns at once as fit in one cache line.
+ **/
+static const int s_cacheLineSize = 64;
+
+#if LIGHTLY_HAVE_BOXBLUR_SIMD
+
+static inline __m128i mulLo32Sse2(__m128i a, __m128i b)
+{
+    // SSE2 has no 32-bit low multiply, emulate it with two widening multiplies.
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i loadLanesSse2(const uint32_t *src, int position, int half)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + position * s_laneCount) + half);
+}
+
+static inline void storeLanesSse2(uint32_t *dst, int position, int half, __m128i sum, __m128i reciprocal)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + position * s_laneCount) + half,
+                     _mm_srli_epi32(mulLo32Sse2(sum, reciprocal), 24));
+}
+
+static void boxBlurLanesSse2(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const __m128i reciprocal = _mm_set1_epi32((1 << 24) / boxSize);
+
+    // Lanes 0-3 and 4-7 are processed side by side.
+    const __m128i firstLo = loadLanesSse2(src, 0, 0);
+    const __m128i firstHi = loadLanesSse2(src, 0, 1);
+    const __m128i lastLo = loadLanesSse2(src, length - 1, 0);
+    const __m128i lastHi = loadLanesSse2(src, length - 1, 1);
+
+    const __m128i bias = _mm_set1_epi32((boxSize + 1) / 2);
+    const __m128i leftLobe = _mm_set1_epi32(lobes.left);
+    __m128i sumLo = _mm_add_epi32(bias, mulLo32Sse2(firstLo, leftLobe));
+    __m128i sumHi = _mm_add_epi32(bias, mulLo32Sse2(firstHi, leftLobe));
+
+    for (int i = 0; i <= lobes.right; ++i) {
+        const int position = qMin(i, length - 1);
+        sumLo = _mm_add_epi32(sumLo, loadLanesSse2(src, position, 0));
+        sumHi = _mm_add_epi32(sumHi, loadLanesSse2(src, position, 1));
+    }
+
+    int i = 0;
+    for (; i < lobes.left && i < length; ++i) {
+        storeLanesSse2(dst, i, 0, sumLo, reciprocal);
+        storeLanesSse2(dst, i, 1, sumHi, reciprocal);
+        const int position = qMin(i + lobes.right + 1, length - 1);
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(loadLanesSse2(src, position, 0), firstLo));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(loadLanesSse2(src, position, 1), firstHi));
+    }
+
+    for (; i + lobes.right + 1 < length; ++i) {
+        storeLanesSse2(dst, i, 0, sumLo, reciprocal);
+        storeLanesSse2(dst, i, 1, sumHi, reciprocal);
+        const int right = i + lobes.right + 1;
+        const int left = i - lobes.left;
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(loadLanesSse2(src, right, 0), loadLanesSse2(src, left, 0)));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(loadLanesSse2(src, right, 1), loadLanesSse2(src, left, 1)));
+    }
+
+    for (; i < length; ++i) {
+        storeLanesSse2(dst, i, 0, sumLo, reciprocal);
+        storeLanesSse2(dst, i, 1, sumHi, reciprocal);
+        const int left = qMax(i - lobes.left, 0);
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(lastLo, loadLanesSse2(src, left, 0)));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(lastHi, loadLanesSse2(src, left, 1)));
+    }
+}
+
+__attribute__((target("avx2"))) static inline __m256i loadLanesAvx2(const uint32_t *src, int position)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + position * s_laneCount));
+}
+
+__attribute__((target("avx2"))) static inline void storeLanesAvx2(uint32_t *dst, int position, __m256i sum, __m256i reciprocal)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + position * s_laneCount),
+                        _mm256_srli_epi32(_mm256_mullo_epi32(sum, reciprocal), 24));
+}
+
+__attribute__((target("avx2"))) static void boxBlurLanesAvx2(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const __m256i reciprocal = _mm256_set1_epi32((1 << 24) / boxSize);
+
+    const __m256i first = loadLanesAvx2(src, 0);
+    const __m256i last = loadLanesAvx2(src, length - 1);
+
+    __m256i sum = _mm256_add_epi32(_mm256_set1_epi32((boxSize + 1) / 2),
+                                   _mm256_mullo_epi32(first, _mm256_set1_epi32(lobes.left)));
+
+    for (int i = 0; i <= lobes.right; ++i) {
+        sum = _mm256_add_epi32(sum, loadLanesAvx2(src, qMin(i, length - 1)));
+    }
+
+    int i = 0;
+    for (; i < lobes.left && i < length; ++i) {
+        storeLanesAvx2(dst, i, sum, reciprocal);
+        const int position = qMin(i + lobes.right + 1, length - 1);
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(loadLanesAvx2(src, position), first));
+    }
+
+    for (; i + lobes.right + 1 < length; ++i) {
+        storeLanesAvx2(dst, i, sum, reciprocal);
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(loadLanesAvx2(src, i + lobes.right + 1),
+                                                     loadLanesAvx2(src, i - lobes.left)));
+    }
+
+    for (; i < length; ++i) {
+        storeLanesAvx2(dst, i, sum, reciprocal);
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(last, loadLanesAvx2(src, qMax(i - lobes.left, 0))));
+    }
+}
+
+#endif
+
+/**
+ * Select the fastest box filter supported by the running CPU.
+ *
+ * @returns The vectorized box filter, or nullptr if only the scalar
+ *    boxBlurRowAlpha can be used.
+ **/
+static BoxBlurLanesFunc resolveBoxBlurLanes()
+{
+#if LIGHTLY_HAVE_BOXBLUR_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return boxBlurLanesAvx2;
+    }
+    return boxBlurLanesSse2;
+#else
+    return nullptr;
+#endif
+}
+
+static inline BoxBlurLanesFunc boxBlurLanesKernel()
+{
+    static const BoxBlurLanesFunc kernel = resolveBoxBlurLanes();
+    return kernel;
+}
+
+QVector<BoxBlurLanesKernel> supportedBoxBlurLanesKernels()
+{
+    QVector<BoxBlurLanesKernel> kernels;
+#if LIGHTLY_HAVE_BOXBLUR_SIMD
+    kernels.append({"sse2", boxBlurLanesSse2});
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.append({"avx2", boxBlurLanesAvx2});
+    }
+#endif
+    return kernels;
+}
+
+void boxBlurRowAlphaScalar(const uint8_t *src, uint8_t *dst, int width, const BoxLobes &lobes)
+{
+    boxBlurRowAlpha(src, dst, width, 1, width, lobes, false, false);
+}
+
+/**
+ * Blur s_laneCount rows or columns with the vectorized box filter.
+ *
+ * @param data The first alpha value of the first row.
+ * @param length The length of the rows, in pixels.
+ * @param positionStep The number of bytes from one alpha value to the next
+ *    alpha value within a row.
+ * @param laneStep The number of bytes from one row to the next row.
+ * @param lobes Params of the three box filters.
+ * @param buffers Scratch memory, at least 3 * length * s_laneCount values.
+ **/
+static void boxBlurLanesAlpha(uint8_t *data, int length, int positionStep, int laneStep,
+                              const QVector<BoxLobes> &lobes, BoxBlurLanesFunc boxBlurLanes, uint32_t *buffers)
+{
+    uint32_t *buf0 = buffers;
+    uint32_t *buf1 = buf0 + length * s_laneCount;
+    uint32_t *buf2 = buf1 + length * s_laneCount;
+
+    const uint8_t *in = data;
+    for (int i = 0; i < length; ++i, in += positionStep) {
+        for (int lane = 0; lane < s_laneCount; ++lane) {
+            buf0[i * s_laneCount + lane] = in[lane * laneStep];
+        }
+    }
+
+    boxBlurLanes(buf0, buf1, length, lobes[0]);
+    boxBlurLanes(buf1, buf2, length, lobes[1]);
+    boxBlurLanes(buf2, buf0, length, lobes[2]);
+
+    uint8_t *out = data;
+    for (int i = 0; i < length; ++i, out += positionStep) {
+        for (int lane = 0; lane < s_laneCount; ++lane) {
+            out[lane * laneStep] = buf0[i * s_laneCount + lane];
+        }
+    }
+}
+
+//* Blurred images smaller than this, in pixels, are not split between threads.
+static const int s_parallelPixelThreshold = 128 * 128;
+
+//* Fewest rows or columns given to a thread.
+static const int s_minBandSize = 32;
+
+struct BoxBlurParams
+{
+    uint8_t *data;                 ///< first alpha value of the blurred area
+    int width;                     ///< width of the blurred area
+    int height;                    ///< height of the blurred area
+    int rowStride;                 ///< bytes from one row to the next
+    int pixelStride;               ///< bytes from one pixel to the next
+    QVector<BoxLobes> lobes;       ///< params of the three box filters
+    BoxBlurLanesFunc boxBlurLanes; ///< vectorized box filter, or nullptr
+};
+
+/**
+ * Blur a band of rows in horizontal direction.
+ *
+ * @param params The blurred area.
+ * @param firstRow The first row of the band.
+ * @param rowCount The number of rows in the band.
+ **/
+static void boxBlurRowsAlpha(const BoxBlurParams &params, int firstRow, int rowCount)
+{
+    const int width = params.width;
+    const int pixelStride = params.pixelStride;
+    const int rowStride = params.rowStride;
+
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * width * pixelStride]);
+    uint8_t *buf1 = buf.data();
+    uint8_t *buf2 = buf1 + width * pixelStride;
+
+    // Rows that are not handled by the vectorized box filter go through
+    // the scalar one.
+    int i = 0;
+
+    if (params.boxBlurLanes) {
+        QScopedPointer<uint32_t, QScopedPointerArrayDeleter<uint32_t> > lanesBuf(new uint32_t[3 * width * s_laneCount]);
+        for (; i + s_laneCount <= rowCount; i += s_laneCount) {
+            uint8_t *row = params.data + (firstRow + i) * rowStride;
+            boxBlurLanesAlpha(row, width, pixelStride, rowStride, params.lobes, params.boxBlurLanes, lanesBuf.data());
+        }
+    }
+
+    for (; i < rowCount; ++i) {
+        uint8_t *row = params.data + (firstRow + i) * rowStride;
+        boxBlurRowAlpha(row, buf1, width, pixelStride, rowStride, params.lobes[0], false, false);
+        boxBlurRowAlpha(buf1, buf2, width, pixelStride, rowStride, params.lobes[1], false, false);
+        boxBlurRowAlpha(buf2, row, width, pixelStride, rowStride, params.lobes[2], false, false);
+    }
+}
+
+/**
+ * Blur a band of columns in vertical direction.
+ *
+ * Walking down a column touches one alpha value per scanline, so columns are
+ * processed in blocks that are transposed into a small scratch tile, blurred
+ * as rows, and transposed back. This way the image is only ever accessed
+ * along scanlines.
+ *
+ * @param params The blurred area.
+ * @param firstColumn The first column of the band.
+ * @param columnCount The number of columns in the band.
+ * @param columnBlockSize The number of columns transposed at once.
+ **/
+static void boxBlurColumnsAlpha(const BoxBlurParams &params, int firstColumn, int columnCount, int columnBlockSize)
+{
+    const int height = params.height;
+    const int pixelStride = params.pixelStride;
+    const int rowStride = params.rowStride;
+
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * height]);
+    uint8_t *buf1 = buf.data();
+    uint8_t *buf2 = buf1 + height;
+
+    QScopedPointer<uint32_t, QScopedPointerArrayDeleter<uint32_t> > lanesBuf;
+    if (params.boxBlurLanes) {
+        lanesBuf.reset(new uint32_t[3 * height * s_laneCount]);
+    }
+
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > tile(new uint8_t[columnBlockSize * height]);
+
+    for (int x = firstColumn; x < firstColumn + columnCount; x += columnBlockSize) {
+        const int columns = qMin(columnBlockSize, firstColumn + columnCount - x);
+
+        for (int y = 0; y < height; ++y) {
+            const uint8_t *in = params.data + y * rowStride + x * pixelStride;
+            uint8_t *out = tile.data() + y;
+            for (int i = 0; i < columns; ++i, in += pixelStride, out += height) {
+                *out = *in;
+            }
+        }
+
+        int firstScalarColumn = 0;
+        if (params.boxBlurLanes) {
+            for (; firstScalarColumn + s_laneCount <= columns; firstScalarColumn += s_laneCount) {
+                uint8_t *column = tile.data() + firstScalarColumn * height;
+                boxBlurLanesAlpha(column, height, 1, height, params.lobes, params.boxBlurLanes, lanesBuf.data());
+            }
+        }
+
+        for (int i = firstScalarColumn; i < columns; ++i) {
+            uint8_t *column = tile.data() + i * height;
+            boxBlurRowAlpha(column, buf1, height, 1, height, params.lobes[0], false, false);
+            boxBlurRowAlpha(buf1, buf2, height, 1, height, params.lobes[1], false, false);
+            boxBlurRowAlpha(buf2, column, height, 1, height, params.lobes[2], false, false);
+        }
+
+        for (int y = 0; y < height; ++y) {
+            const uint8_t *in = tile.data() + y;
+            uint8_t *out = params.data + y * rowStride + x * pixelStride;
+            for (int i = 0; i < columns; ++i, in += height, out += pixelStride) {
+                *out = *in;
+            }
+        }
+    }
+}
+
+/**
+ * Blur a band of columns in vertical direction, walking down each column.
+ *
+ * This touches one alpha value per scanline, and is only kept as a reference
+ * for boxBlurColumnsAlpha.
+ *
+ * @param params The blurred area.
+ * @param firstColumn The first column of the band.
+ * @param columnCount The number of columns in the band.
+ **/
+static void boxBlurColumnsAlphaStrided(const BoxBlurParams &params, int firstColumn, int columnCount)
+{
+    const int height = params.height;
+    const int pixelStride = params.pixelStride;
+    const int rowStride = params.rowStride;
+
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * height * pixelStride]);
+    uint8_t *buf1 = buf.data();
+    uint8_t *buf2 = buf1 + height * pixelStride;
+
+    int i = 0;
+
+    if (params.boxBlurLanes) {
+        QScopedPointer<uint32_t, QScopedPointerArrayDeleter<uint32_t> > lanesBuf(new uint32_t[3 * height * s_laneCount]);
+        for (; i + s_laneCount <= columnCount; i += s_laneCount) {
+            uint8_t *column = params.data + (firstColumn + i) * pixelStride;
+            boxBlurLanesAlpha(column, height, rowStride, pixelStride, params.lobes, params.boxBlurLanes, lanesBuf.data());
+        }
+    }
+
+    for (; i < columnCount; ++i) {
+        uint8_t *column = params.data + (firstColumn + i) * pixelStride;
+        boxBlurRowAlpha(column, buf1, height, pixelStride, rowStride, params.lobes[0], true, false);
+        boxBlurRowAlpha(buf1, buf2, height, pixelStride, rowStride, params.lobes[1], false, false);
+        boxBlurRowAlpha(buf2, column, height, pixelStride, rowStride, params.lobes[2], false, true);
+    }
+}
+
+/**
+ * Split a range into bands for the worker pool.
+ *
+ * @param length The length of the range.
+ * @param granularity Bands start at multiples of this value.
+ * @returns The size of a band; the last one may be shorter.
+ **/
+static int calculateBandSize(int length, int granularity)
+{
+    const int bandCount = qBound(1, length / s_minBandSize, WorkerPool::concurrency());
+    const int bandSize = (length + bandCount - 1) / bandCount;
+    return (bandSize + granularity - 1) / granularity * granularity;
+}
+
+/**
+ * Blur the alpha channel of a given image.
+ *
+ * @param image The input image, in ARGB32 or Alpha8 format.
+ * @param radius The blur radius.
+ * @param rect The part of the image to blur, or a null rect for the whole image.
+ * @param layout The layout of the vertical pass.
+ **/
+static void boxBlurAlpha(QImage &image, int radius, const QRect &rect, BoxBlurColumnLayout layout)
+{
+    if (radius < 2) {
+        return;
+    }
+
+    const QRect blurRect = rect.isNull() ? image.rect() : rect;
+
+    BoxBlurParams params;
+    params.width = blurRect.width();
+    params.height = blurRect.height();
+    params.rowStride = image.bytesPerLine();
+    params.pixelStride = image.depth() >> 3;
+    params.lobes = computeLobes(radius);
+    params.boxBlurLanes = boxBlurLanesKernel();
+
+    // Detach once here, the bands below only work on raw pixels.
+    params.data = image.bits() + blurRect.y() * params.rowStride + blurRect.x() * params.pixelStride + alphaChannelOffset(image);
+
+    const int columnBlockSize = layout == BoxBlurColumnLayout::Blocked
+        ? qMax(s_laneCount, s_cacheLineSize / params.pixelStride)
+        : s_laneCount;
+
+    const auto blurColumns = [&](int firstColumn, int columnCount) {
+        if (layout == BoxBlurColumnLayout::Blocked) {
+            boxBlurColumnsAlpha(params, firstColumn, columnCount, columnBlockSize);
+        } else {
+            boxBlurColumnsAlphaStrided(params, firstColumn, columnCount);
+        }
+    };
+
+    if (params.width * params.height < s_parallelPixelThreshold) {
+        boxBlurRowsAlpha(params, 0, params.height);
+        blurColumns(0, params.width);
+        return;
+    }
+
+    // Rows are independent in the horizontal pass and columns are independent
+    // in the vertical one, so both passes are split into bands.
+    const int rowBandSize = calculateBandSize(params.height, s_laneCount);
+    WorkerPool::run((params.height + rowBandSize - 1) / rowBandSize, [&](int band) {
+        const int firstRow = band * rowBandSize;
+        boxBlurRowsAlpha(params, firstRow, qMin(rowBandSize, params.height - firstRow));
+    });
+
+    const int columnBandSize = calculateBandSize(params.width, columnBlockSize);
+    WorkerPool::run((params.width + columnBandSize - 1) / columnBandSize, [&](int band) {
+        const int firstColumn = band * columnBandSize;
+        blurColumns(firstColumn, qMin(columnBandSize, params.width - firstColumn));
+    });
+}
+
+void boxBlurAlpha(QImage &image, int radius, const QRect &rect)
+{
+    boxBlurAlpha(image, radius, rect, BoxBlurColumnLayout::Blocked);
+}
+
+void boxBlurAlpha(QImage &image, int radius, BoxBlurColumnLayout layout)
+{
+    boxBlurAlpha(image, radius, QRect(), layout);
+}
+
+} // namespace Lightly
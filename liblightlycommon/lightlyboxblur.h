@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 Vlad Zahorodnii <vlad.zahorodnii@kde.org>
+ *
+ * The box blur implementation is based on AlphaBoxBlur from Firefox.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include "lightlycommon_export.h"
+
+// Qt
+#include <QImage>
+#include <QRect>
+#include <QVector>
+#include <QtMath>
+
+namespace Lightly
+{
+
+inline int calculateBlurRadius(qreal stdDev)
+{
+    // See https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement
+    const qreal gaussianScaleFactor = (3.0 * qSqrt(2.0 * M_PI) / 4.0) * 1.5;
+    return qMax(2, qFloor(stdDev * gaussianScaleFactor + 0.5));
+}
+
+inline qreal calculateBlurStdDev(int radius)
+{
+    // See https://www.w3.org/TR/css-backgrounds-3/#shadow-blur
+    return radius * 0.5;
+}
+
+struct BoxLobes
+{
+    int left;  ///< how many pixels sample to the left
+    int right; ///< how many pixels sample to the right
+};
+
+/**
+ * Compute box filter parameters.
+ *
+ * @param radius The blur radius.
+ * @returns Parameters for three box filters.
+ **/
+LIGHTLYCOMMON_EXPORT QVector<BoxLobes> computeLobes(int radius);
+
+/**
+ * Blur the alpha channel of a given image.
+ *
+ * @param image The input image, in ARGB32 or Alpha8 format.
+ * @param radius The blur radius.
+ * @param rect Specifies what part of the image to blur. If nothing is provided, then
+ *    the whole alpha channel of the input image will be blurred.
+ **/
+LIGHTLYCOMMON_EXPORT void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {});
+
+} // namespace Lightly
@@ -0,0 +1,94 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// Internals of the box blur, exposed for autotests and benchmarks only.
+
+// own
+#include "lightlyboxblur.h"
+
+namespace Lightly
+{
+
+/**
+ * Number of rows or columns that are blurred at once by the vectorized
+ * box filter.
+ **/
+static const int s_laneCount = 8;
+
+/**
+ * Process interleaved rows with a box filter.
+ *
+ * Both buffers hold s_laneCount independent rows, interleaved so that the
+ * values at a given position of all rows are adjacent. Each row is filtered
+ * exactly as boxBlurRowAlpha would do.
+ *
+ * @param src The interleaved input rows.
+ * @param dst The interleaved output rows.
+ * @param length The length of the rows, in pixels.
+ * @param lobes Params of the box filter.
+ **/
+using BoxBlurLanesFunc = void (*)(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes);
+
+struct BoxBlurLanesKernel
+{
+    const char *name;     ///< instruction set of the kernel
+    BoxBlurLanesFunc run; ///< the kernel
+};
+
+/**
+ * List the vectorized box filters the running CPU supports.
+ *
+ * boxBlurAlpha dispatches to the last one.
+ **/
+LIGHTLYCOMMON_EXPORT QVector<BoxBlurLanesKernel> supportedBoxBlurLanesKernels();
+
+/**
+ * Process a contiguous row with the scalar box filter.
+ *
+ * This is the reference the vectorized box filters must match bit for bit.
+ *
+ * @param src The row.
+ * @param dst The destination.
+ * @param width The width of the row, in pixels. It must not be smaller than
+ *    the box filter.
+ * @param lobes Params of the box filter.
+ **/
+LIGHTLYCOMMON_EXPORT void boxBlurRowAlphaScalar(const uint8_t *src, uint8_t *dst, int width, const BoxLobes &lobes);
+
+/**
+ * Memory layout of the vertical pass of boxBlurAlpha.
+ **/
+enum class BoxBlurColumnLayout {
+    /// Walk down every column, one scanline per alpha value. Kept as a reference.
+    Strided,
+    /// Transpose blocks of columns into a scratch tile and blur them as rows.
+    Blocked
+};
+
+/**
+ * Blur the alpha channel of a given image with a given vertical pass layout.
+ *
+ * Both layouts give the same result; boxBlurAlpha uses BoxBlurColumnLayout::Blocked.
+ *
+ * @param image The input image, in ARGB32 or Alpha8 format.
+ * @param radius The blur radius.
+ * @param layout The layout of the vertical pass.
+ **/
+LIGHTLYCOMMON_EXPORT void boxBlurAlpha(QImage &image, int radius, BoxBlurColumnLayout layout);
+
+} // namespace Lightly
@@ -1,8 +1,6 @@
 /*
  * Copyright (C) 2018 Vlad Zahorodnii <vlad.zahorodnii@kde.org>
  *
- * The box blur implementation is based on AlphaBoxBlur from Firefox.
- *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
@@ -20,26 +18,20 @@
 
 // own
 #include "lightlyboxshadowrenderer.h"
+#include "lightlyboxblur.h"
+#include "lightlyshadowtexturecache.h"
+#include "lightlyworkerpool.h"
 
 // Qt
+#include <QDataStream>
 #include <QPainter>
 #include <QtMath>
 #include <QDebug>
-namespace Lightly
-{
 
-static inline int calculateBlurRadius(qreal stdDev)
-{
-    // See https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement
-    const qreal gaussianScaleFactor = (3.0 * qSqrt(2.0 * M_PI) / 4.0) * 1.5;
-    return qMax(2, qFloor(stdDev * gaussianScaleFactor + 0.5));
-}
+#include <cmath>
 
-static inline qreal calculateBlurStdDev(int radius)
+namespace Lightly
 {
-    // See https://www.w3.org/TR/css-backgrounds-3/#shadow-blur
-    return radius * 0.5;
-}
 
 static inline QSize calculateBlurExtent(int radius)
 {
@@ -47,246 +39,395 @@ static inline QSize calculateBlurExtent(int radius)
     return QSize(blurRadius, blurRadius);
 }
 
-struct BoxLobes
-{
-    int left;  ///< how many pixels sample to the left
-    int right; ///< how many pixels sample to the right
-};
+/**
+ * Number of samples per pixel used to integrate the rounded corners of the
+ * box in the analytic shadow backend.
+ **/
+static const int s_cornerSamplesPerPixel = 4;
 
 /**
- * Compute box filter parameters.
+ * Shadow textures smaller than this, in device pixels, have their layers
+ * rendered one after another; threads would cost more than they save.
+ **/
+static const int s_parallelPixelThreshold = 256 * 256;
+
+/**
+ * Compute the standard deviation of the Gaussian approximated by boxBlurAlpha.
  *
  * @param radius The blur radius.
- * @returns Parameters for three box filters.
  **/
-static QVector<BoxLobes> computeLobes(int radius)
+static qreal calculateBoxBlurStdDev(int radius)
 {
-    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
-    const int z = blurRadius / 3;
-
-    int major;
-    int minor;
-    int final;
-
-    switch (blurRadius % 3) {
-    case 0:
-        major = z;
-        minor = z;
-        final = z;
-        break;
-
-    case 1:
-        major = z + 1;
-        minor = z;
-        final = z;
-        break;
-
-    case 2:
-        major = z + 1;
-        minor = z;
-        final = z + 1;
-        break;
-
-    default:
-        Q_UNREACHABLE();
+    qreal variance = 0;
+    for (const BoxLobes &lobes : computeLobes(radius)) {
+        const int boxSize = lobes.left + 1 + lobes.right;
+        variance += (boxSize * boxSize - 1) / 12.0;
     }
+    return qSqrt(variance);
+}
 
-    Q_ASSERT(major + minor + final == blurRadius);
-
-    return {
-        {major, minor},
-        {minor, major},
-        {final, final}
-    };
+/**
+ * The cumulative distribution function of a centered normal distribution.
+ **/
+static inline qreal normalCdf(qreal x, qreal stdDev)
+{
+    return 0.5 * (1.0 + std::erf(x / (stdDev * M_SQRT2)));
 }
 
 /**
- * Process a row with a box filter.
+ * Compute the Gaussian-blurred coverage of a rounded box in closed form and
+ * store it in the alpha channel of a given image.
+ *
+ * Away from the corners the blurred box is separable, so its coverage is the
+ * product of two erf profiles. Rows of the box that go through the rounded
+ * corners are integrated in thin slices; the horizontal profile of each slice
+ * and its vertical weight for each row of the image are tabulated up front.
  *
- * @param src The start of the row.
- * @param dst The destination.
- * @param width The width of the row, in pixels.
- * @param horizontalStride The number of bytes from one alpha value to the
- *    next alpha value.
- * @param verticalStride The number of bytes from one row to the next row.
- * @param lobes Params of the box filter.
- * @param transposeInput Whether the input is transposed.
- * @param transposeOutput Whether the output should be transposed.
+ * @param image The output image, in Alpha8 format.
+ * @param box The box, in device pixels.
+ * @param xRadius The horizontal radius of box' corners, in device pixels.
+ * @param yRadius The vertical radius of box' corners, in device pixels.
+ * @param radius The blur radius, in device pixels.
+ * @param rect Specifies what part of the image to fill.
  **/
-static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width, int horizontalStride,
-                                   int verticalStride, const BoxLobes &lobes, bool transposeInput,
-                                   bool transposeOutput)
+static void renderAnalyticShadowAlpha(QImage &image, const QRectF &box, qreal xRadius, qreal yRadius,
+                                      int radius, const QRect &rect)
 {
-    const int inputStep = transposeInput ? verticalStride : horizontalStride;
-    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
+    const qreal stdDev = calculateBoxBlurStdDev(radius);
 
-    const int boxSize = lobes.left + 1 + lobes.right;
-    const int reciprocal = (1 << 24) / boxSize;
+    xRadius = qBound(0.0, xRadius, box.width() * 0.5);
+    yRadius = qBound(0.0, yRadius, box.height() * 0.5);
 
-    uint32_t alphaSum = (boxSize + 1) / 2;
+    const int width = rect.width();
+    const int height = rect.height();
 
-    const uint8_t *left = src;
-    const uint8_t *right = src;
-    uint8_t *out = dst;
+    // Coverage of the straight part of the box.
+    QVector<qreal> straightColumns(width);
+    for (int x = 0; x < width; ++x) {
+        const qreal px = rect.x() + x + 0.5;
+        straightColumns[x] = normalCdf(px - box.left(), stdDev) - normalCdf(px - box.right(), stdDev);
+    }
 
-    const uint8_t firstValue = src[0];
-    const uint8_t lastValue = src[(width - 1) * inputStep];
+    QVector<qreal> straightRows(height);
+    for (int y = 0; y < height; ++y) {
+        const qreal py = rect.y() + y + 0.5;
+        straightRows[y] = normalCdf(py - box.top() - yRadius, stdDev) - normalCdf(py - box.bottom() + yRadius, stdDev);
+    }
 
-    alphaSum += firstValue * lobes.left;
+    // Coverage of the slices going through the top and the bottom corners.
+    const int bandSamples = yRadius > 0 ? qCeil(yRadius * s_cornerSamplesPerPixel) : 0;
+    const int sliceCount = 2 * bandSamples;
+    const qreal sliceHeight = bandSamples > 0 ? yRadius / bandSamples : 0;
+
+    QVector<qreal> sliceColumns(sliceCount * width);
+    QVector<qreal> sliceRows(sliceCount * height);
+
+    for (int i = 0; i < sliceCount; ++i) {
+        const bool topBand = i < bandSamples;
+        const qreal sliceTop = topBand
+            ? box.top() + i * sliceHeight
+            : box.bottom() - yRadius + (i - bandSamples) * sliceHeight;
+        const qreal sliceCenter = sliceTop + 0.5 * sliceHeight;
+
+        // Distance from the slice to the line through the centers of the corners.
+        const qreal dy = topBand
+            ? box.top() + yRadius - sliceCenter
+            : sliceCenter - (box.bottom() - yRadius);
+        const qreal inset = xRadius * (1.0 - qSqrt(qMax(0.0, 1.0 - (dy * dy) / (yRadius * yRadius))));
+
+        for (int x = 0; x < width; ++x) {
+            const qreal px = rect.x() + x + 0.5;
+            sliceColumns[i * width + x] = normalCdf(px - box.left() - inset, stdDev)
+                - normalCdf(px - box.right() + inset, stdDev);
+        }
 
-    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
-    while (right < initEnd) {
-        alphaSum += *right;
-        right += inputStep;
+        for (int y = 0; y < height; ++y) {
+            const qreal py = rect.y() + y + 0.5;
+            sliceRows[i * height + y] = normalCdf(py - sliceTop, stdDev)
+                - normalCdf(py - sliceTop - sliceHeight, stdDev);
+        }
     }
 
-    const uint8_t *leftEnd = src + boxSize * inputStep;
-    while (right < leftEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - firstValue;
-        right += inputStep;
-        out += outputStep;
-    }
+    QVector<qreal> coverage(width);
+    for (int y = 0; y < height; ++y) {
+        const qreal straightRow = straightRows[y];
+        for (int x = 0; x < width; ++x) {
+            coverage[x] = straightRow * straightColumns[x];
+        }
 
-    const uint8_t *centerEnd = src + width * inputStep;
-    while (right < centerEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - *left;
-        left += inputStep;
-        right += inputStep;
-        out += outputStep;
-    }
+        for (int i = 0; i < sliceCount; ++i) {
+            const qreal sliceRow = sliceRows[i * height + y];
+            if (sliceRow < 1e-6) {
+                continue;
+            }
 
-    const uint8_t *rightEnd = dst + width * outputStep;
-    while (out < rightEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += lastValue - *left;
-        left += inputStep;
-        out += outputStep;
+            const qreal *sliceColumn = sliceColumns.constData() + i * width;
+            for (int x = 0; x < width; ++x) {
+                coverage[x] += sliceRow * sliceColumn[x];
+            }
+        }
+
+        uint8_t *out = image.scanLine(rect.y() + y) + rect.x();
+        for (int x = 0; x < width; ++x) {
+            out[x] = qBound(0, qRound(coverage[x] * 255), 255);
+        }
     }
 }
 
 /**
- * Blur the alpha channel of a given image.
+ * The coverage of a single blurred shadow box, stored as a nine-patch.
  *
- * @param image The input image.
- * @param radius The blur radius.
- * @param rect Specifies what part of the image to blur. If nothing is provided, then
- *    the whole alpha channel of the input image will be blurred.
+ * The mask is symmetrical, so only its top-left corner is stored. Past the
+ * rounded corner and the reach of the blur, all columns of the corner are
+ * equal, and so are all rows. Hence the last column of the corner image is
+ * the one pixel wide profile of the left edge, its last row is the profile
+ * of the top edge, and the rest of the mask is built by mirroring and
+ * stretching the corner image.
  **/
-static inline void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {})
+struct ShadowMask
 {
-    if (radius < 2) {
-        return;
+    QImage corner; ///< top-left corner, in Alpha8 format
+    QSize size;    ///< size of the whole mask, in device pixels
+
+    /**
+     * The row of the corner image that holds a given row of the whole mask.
+     **/
+    inline const uint8_t *scanLine(int y) const
+    {
+        y = qMin(qMin(y, size.height() - 1 - y), corner.height() - 1);
+        return corner.constScanLine(y);
     }
 
-    const QVector<BoxLobes> lobes = computeLobes(radius);
+    /**
+     * The index in a row of the corner image of a given column of the whole mask.
+     **/
+    inline int column(int x) const
+    {
+        return qMin(qMin(x, size.width() - 1 - x), corner.width() - 1);
+    }
+};
+
+/**
+ * Where a single blurred shadow box and the corner of its mask lie.
+ **/
+struct ShadowMaskGeometry
+{
+    QSize size;        ///< size of the mask, in logical pixels
+    QRect boxRect;     ///< the box, in the mask, in logical pixels
+    qreal boxXRadius;  ///< radius of box' corners, as passed to drawRoundedRect
+    qreal boxYRadius;  ///< radius of box' corners, as passed to drawRoundedRect
+    int scaledRadius;  ///< blur radius, in device pixels
+    QSize cornerSize;  ///< size of the corner of the mask, in device pixels
+};
+
+/**
+ * Compute the geometry of a single blurred shadow box.
+ *
+ * @param boxSize The size of the box.
+ * @param borderRadius The radius of box' corners.
+ * @param radius The blur radius.
+ * @param dpr The device pixel ratio.
+ **/
+static ShadowMaskGeometry calculateShadowMaskGeometry(const QSize &boxSize, qreal borderRadius, int radius, qreal dpr)
+{
+    ShadowMaskGeometry geometry;
+    geometry.size = boxSize + 2 * calculateBlurExtent(radius);
 
-    const QRect blurRect = rect.isNull() ? image.rect() : rect;
+    geometry.boxRect = QRect(QPoint(0, 0), boxSize);
+    geometry.boxRect.moveCenter(QRect(QPoint(0, 0), geometry.size).center());
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int width = blurRect.width();
-    const int height = blurRect.height();
-    const int rowStride = image.bytesPerLine();
-    const int pixelStride = image.depth() >> 3;
+    const qreal xRadius = 2.0 * borderRadius / geometry.boxRect.width();
+    const qreal yRadius = 2.0 * borderRadius / geometry.boxRect.height();
 
-    const int bufferStride = qMax(width, height) * pixelStride;
-    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * bufferStride]);
-    uint8_t *buf1 = buf.data();
-    uint8_t *buf2 = buf1 + bufferStride;
+    // For some reason, if radius is <=3, the shadow edge becomes too sharp, so we work around this. FIXME
+    geometry.boxXRadius = radius > 3 ? xRadius : borderRadius;
+    geometry.boxYRadius = radius > 3 ? yRadius : borderRadius;
+
+    // The corner ends where columns and rows no longer see the rounded corner
+    // of the box through the blur, but never past the center of the mask.
+    const QSize scaledSize = geometry.size * dpr;
+    geometry.scaledRadius = qRound(radius * dpr);
+    const int reach = calculateBlurExtent(geometry.scaledRadius).width();
+    geometry.cornerSize = QSize(
+        qMin(qCeil(scaledSize.width() * 0.5), qCeil((geometry.boxRect.x() + geometry.boxXRadius) * dpr) + reach + 1),
+        qMin(qCeil(scaledSize.height() * 0.5), qCeil((geometry.boxRect.y() + geometry.boxYRadius) * dpr) + reach + 1));
+
+    return geometry;
+}
 
-    // Blur the image in horizontal direction.
-    for (int i = 0; i < height; ++i) {
-        uint8_t *row = image.scanLine(blurRect.y() + i) + blurRect.x() * pixelStride + alphaOffset;
-        boxBlurRowAlpha(row, buf1, width, pixelStride, rowStride, lobes[0], false, false);
-        boxBlurRowAlpha(buf1, buf2, width, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, row, width, pixelStride, rowStride, lobes[2], false, false);
+/**
+ * Render the coverage of a single blurred shadow box.
+ *
+ * Only the corner of the mask and its edge profiles are rasterized and
+ * blurred, the interior of the box and the other three corners are never
+ * touched.
+ *
+ * @param boxSize The size of the box.
+ * @param borderRadius The radius of box' corners.
+ * @param radius The blur radius.
+ * @param dpr The device pixel ratio.
+ * @param backend The backend used to generate the shadow.
+ * @returns The mask, with the box centered in it.
+ **/
+static ShadowMask renderShadowMask(const QSize &boxSize, qreal borderRadius, int radius, qreal dpr,
+                                   BoxShadowRenderer::Backend backend)
+{
+    const ShadowMaskGeometry geometry = calculateShadowMaskGeometry(boxSize, borderRadius, radius, dpr);
+    const QRect &boxRect = geometry.boxRect;
+    const qreal boxXRadius = geometry.boxXRadius;
+    const qreal boxYRadius = geometry.boxYRadius;
+    const int scaledRadius = geometry.scaledRadius;
+
+    ShadowMask mask;
+    mask.size = geometry.size * dpr;
+
+    mask.corner = QImage(geometry.cornerSize, QImage::Format_Alpha8);
+    mask.corner.setDevicePixelRatio(dpr);
+    mask.corner.fill(Qt::transparent);
+
+    if (backend == BoxShadowRenderer::Backend::Analytic && scaledRadius >= 2) {
+        const QRectF scaledBoxRect(boxRect.x() * dpr, boxRect.y() * dpr, boxRect.width() * dpr, boxRect.height() * dpr);
+        renderAnalyticShadowAlpha(mask.corner, scaledBoxRect, boxXRadius * dpr, boxYRadius * dpr, scaledRadius, mask.corner.rect());
+    } else {
+        //qDebug() << " radius: " << radius;
+        QPainter shadowPainter(&mask.corner);
+        shadowPainter.setRenderHint(QPainter::Antialiasing);
+        shadowPainter.setPen(Qt::NoPen);
+        shadowPainter.setBrush(Qt::black);
+        //shadowPainter.drawRoundedRect(boxRect, xRadius, yRadius);
+        shadowPainter.drawRoundedRect(boxRect, boxXRadius, boxYRadius);
+        shadowPainter.end();
+
+        boxBlurAlpha(mask.corner, scaledRadius);
     }
 
-    // Blur the image in vertical direction.
-    for (int i = 0; i < width; ++i) {
-        uint8_t *column = image.scanLine(blurRect.y()) + (blurRect.x() + i) * pixelStride + alphaOffset;
-        boxBlurRowAlpha(column, buf1, height, pixelStride, rowStride, lobes[0], true, false);
-        boxBlurRowAlpha(buf1, buf2, height, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, column, height, pixelStride, rowStride, lobes[2], false, true);
-    }
+    return mask;
 }
 
-static inline void mirrorTopLeftQuadrant(QImage &image)
+/**
+ * Multiply all channels of a premultiplied pixel by a given alpha.
+ **/
+static inline QRgb multiplyPixel(QRgb pixel, uint alpha)
 {
-    const int width = image.width();
-    const int height = image.height();
+    uint t = (pixel & 0xff00ff) * alpha;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
 
-    const int centerX = qCeil(width * 0.5);
-    const int centerY = qCeil(height * 0.5);
+    pixel = ((pixel >> 8) & 0xff00ff) * alpha;
+    pixel = (pixel + ((pixel >> 8) & 0xff00ff) + 0x800080);
+    pixel &= 0xff00ff00;
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int stride = image.depth() >> 3;
+    return pixel | t;
+}
 
-    for (int y = 0; y < centerY; ++y) {
-        uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = in + (width - 1) * stride;
+struct ShadowLayer
+{
+    ShadowMask mask; ///< coverage of the layer
+    QPoint position; ///< position of the mask in the canvas, in device pixels
+    QRgb color;      ///< premultiplied color of the layer
+};
 
-        for (int x = 0; x < centerX; ++x, in += stride, out -= stride) {
-            *out = *in;
-        }
-    }
+/**
+ * The device pixels of a shadow texture along one axis, in the full texture.
+ *
+ * A collapsed texture keeps both ends of the full one and drops a run of
+ * equal pixels from its middle.
+ **/
+struct CanvasAxis
+{
+    int length = 0;  ///< length of the texture, in device pixels
+    int split = 0;   ///< first pixel past the kept start
+    int removed = 0; ///< number of pixels dropped at split
 
-    for (int y = 0; y < centerY; ++y) {
-        const uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = image.scanLine(width - y - 1) + alphaOffset;
+    inline int map(int i) const
+    {
+        return i < split ? i : i + removed;
+    }
+};
 
-        for (int x = 0; x < width; ++x, in += stride, out += stride) {
-            *out = *in;
+/**
+ * Collapse the middle of a shadow texture along one axis.
+ *
+ * The texture keeps as many logical pixels on both sides of its middle one,
+ * so the middle of the collapsed texture is also its center. The device
+ * pixels covering the middle logical pixel, and all the dropped ones, must
+ * be equal to each other in the full texture.
+ *
+ * @param extent The length of the full texture, in logical pixels.
+ * @param first The first of a run of equal device pixels in the full texture.
+ * @param last The last of that run.
+ * @param dpr The device pixel ratio.
+ * @param collapsedExtent Returns the length of the collapsed texture, in logical pixels.
+ **/
+static CanvasAxis collapseCanvasAxis(int extent, int first, int last, qreal dpr, int *collapsedExtent)
+{
+    CanvasAxis axis;
+    axis.length = qRound(extent * dpr);
+    axis.split = axis.length;
+    *collapsedExtent = extent;
+
+    for (int half = 0; 2 * half + 1 < extent; ++half) {
+        const int length = qRound((2 * half + 1) * dpr);
+        const int removed = axis.length - length;
+        const int split = qFloor(half * dpr);
+        if (split >= first && qCeil((half + 1) * dpr) - 1 + removed <= last) {
+            axis.length = length;
+            axis.split = split;
+            axis.removed = removed;
+            *collapsedExtent = 2 * half + 1;
+            break;
         }
     }
+
+    return axis;
 }
 
-static void renderShadow(QPainter *painter, const QRect &rect, qreal borderRadius, const QPoint &offset, int radius, const QColor &color)
+/**
+ * Tint shadow layers and composite them over each other.
+ *
+ * All layers are accumulated row by row, so the canvas is walked once no
+ * matter how many layers there are. The masks are expanded from their
+ * corners on the fly.
+ *
+ * @param canvas The destination, in ARGB32_Premultiplied format.
+ * @param layers The layers, from bottom to top.
+ * @param columns Where the columns of the canvas are in the full texture.
+ * @param rows Where the rows of the canvas are in the full texture.
+ **/
+static void compositeShadowLayers(QImage &canvas, const QVector<ShadowLayer> &layers,
+                                  const CanvasAxis &columns, const CanvasAxis &rows)
 {
-    const QSize inflation = calculateBlurExtent(radius);
-    const QSize size = rect.size() + 2 * inflation;
-
-    const qreal dpr = painter->device()->devicePixelRatioF();
-
-    QImage shadow(size * dpr, QImage::Format_ARGB32_Premultiplied);
-    shadow.setDevicePixelRatio(dpr);
-    shadow.fill(Qt::transparent);
-
-    QRect boxRect(QPoint(0, 0), rect.size());
-    boxRect.moveCenter(QRect(QPoint(0, 0), size).center());
-
-    const qreal xRadius = 2.0 * borderRadius / boxRect.width();
-    const qreal yRadius = 2.0 * borderRadius / boxRect.height();
-    //qDebug() << " radius: " << radius;
-    QPainter shadowPainter;
-    shadowPainter.begin(&shadow);
-    shadowPainter.setRenderHint(QPainter::Antialiasing);
-    shadowPainter.setPen(Qt::NoPen);
-    shadowPainter.setBrush(Qt::black);
-    // For some reason, if radius is <=3, the shadow edge becomes too sharp, so we work around this. FIXME
-    //shadowPainter.drawRoundedRect(boxRect, xRadius, yRadius);
-    shadowPainter.drawRoundedRect(boxRect, radius > 3 ? xRadius : borderRadius, radius > 3 ? yRadius : borderRadius );
-    shadowPainter.end();
-
-    // Because the shadow texture is symmetrical, that's enough to blur
-    // only the top-left quadrant and then mirror it.
-    const QRect blurRect(0, 0, qCeil(shadow.width() * 0.5), qCeil(shadow.height() * 0.5));
-    const int scaledRadius = qRound(radius * dpr);
-    boxBlurAlpha(shadow, scaledRadius, blurRect);
-    mirrorTopLeftQuadrant(shadow);
-
-    // Give the shadow a tint of the desired color.
-    shadowPainter.begin(&shadow);
-    shadowPainter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    shadowPainter.fillRect(shadow.rect(), color);
-    shadowPainter.end();
-
-    // Actually, present the shadow.
-    QRect shadowRect = shadow.rect();
-    shadowRect.setSize(shadowRect.size() / dpr);
-    shadowRect.moveCenter(rect.center() + offset);
-    painter->drawImage(shadowRect, shadow);
+    const int width = canvas.width();
+    const int height = canvas.height();
+
+    for (int y = 0; y < height; ++y) {
+        QRgb *row = reinterpret_cast<QRgb *>(canvas.scanLine(y));
+
+        for (const ShadowLayer &layer : layers) {
+            const int maskY = rows.map(y) - layer.position.y();
+            if (maskY < 0 || maskY >= layer.mask.size.height()) {
+                continue;
+            }
+
+            const int begin = layer.position.x();
+            const int end = begin + layer.mask.size.width();
+            const uint8_t *coverage = layer.mask.scanLine(maskY);
+
+            for (int x = 0; x < width; ++x) {
+                const int canvasX = columns.map(x);
+                if (canvasX < begin || canvasX >= end) {
+                    continue;
+                }
+
+                const uint8_t alpha = coverage[layer.mask.column(canvasX - layer.position.x())];
+                if (!alpha) {
+                    continue;
+                }
+                const QRgb source = multiplyPixel(layer.color, alpha);
+                row[x] = source + multiplyPixel(row[x], 255 - qAlpha(source));
+            }
+        }
+    }
 }
 
 void BoxShadowRenderer::setBoxSize(const QSize &size)
@@ -304,6 +445,16 @@ void BoxShadowRenderer::setDevicePixelRatio(qreal dpr)
     m_dpr = dpr;
 }
 
+void BoxShadowRenderer::setBackend(Backend backend)
+{
+    m_backend = backend;
+}
+
+void BoxShadowRenderer::setPersistentCacheEnabled(bool enabled)
+{
+    m_persistentCacheEnabled = enabled;
+}
+
 void BoxShadowRenderer::addShadow(const QPoint &offset, int radius, const QColor &color)
 {
     Shadow shadow = {};
@@ -314,6 +465,16 @@ void BoxShadowRenderer::addShadow(const QPoint &offset, int radius, const QColor
 }
 
 QImage BoxShadowRenderer::render() const
+{
+    return renderTexture(false, QMargins()).image;
+}
+
+BoxShadowRenderer::Tiles BoxShadowRenderer::renderTiles(const QMargins &frameMargins) const
+{
+    return renderTexture(true, frameMargins);
+}
+
+BoxShadowRenderer::Tiles BoxShadowRenderer::renderTexture(bool collapse, const QMargins &frameMargins) const
 {
     if (m_shadows.isEmpty()) {
         return {};
@@ -325,20 +486,94 @@ QImage BoxShadowRenderer::render() const
             calculateMinimumShadowTextureSize(m_boxSize, shadow.radius, shadow.offset));
     }
 
-    QImage canvas(canvasSize * m_dpr, QImage::Format_ARGB32_Premultiplied);
-    canvas.setDevicePixelRatio(m_dpr);
-    canvas.fill(Qt::transparent);
-
     QRect boxRect(QPoint(0, 0), m_boxSize);
     boxRect.moveCenter(QRect(QPoint(0, 0), canvasSize).center());
 
-    QPainter painter(&canvas);
-    for (const Shadow &shadow : qAsConst(m_shadows)) {
-        renderShadow(&painter, boxRect, m_borderRadius, shadow.offset, shadow.radius, shadow.color);
+    // Layers are placed before anything is rendered, so that the collapsed
+    // texture is laid out up front.
+    QVector<ShadowLayer> layers(m_shadows.count());
+    QVector<ShadowMaskGeometry> geometries(m_shadows.count());
+    for (int i = 0; i < m_shadows.count(); ++i) {
+        const Shadow &shadow = m_shadows.at(i);
+        geometries[i] = calculateShadowMaskGeometry(m_boxSize, m_borderRadius, shadow.radius, m_dpr);
+
+        QRect shadowRect(QPoint(0, 0), geometries.at(i).size);
+        shadowRect.moveCenter(boxRect.center() + shadow.offset);
+        layers[i].position = QPoint(qRound(shadowRect.x() * m_dpr), qRound(shadowRect.y() * m_dpr));
+        layers[i].color = qPremultiply(shadow.color.rgba());
+    }
+
+    // Past the corners of all masks, all columns of the full texture are
+    // equal, and so are all rows. The corners of the frame stay whole too.
+    const QRect frameRect = boxRect.marginsAdded(frameMargins);
+    QPoint first(qCeil((frameRect.left() + m_borderRadius) * m_dpr) + 1,
+                 qCeil((frameRect.top() + m_borderRadius) * m_dpr) + 1);
+    QPoint last(qFloor((frameRect.right() + 1 - m_borderRadius) * m_dpr) - 2,
+                qFloor((frameRect.bottom() + 1 - m_borderRadius) * m_dpr) - 2);
+    for (int i = 0; i < layers.count(); ++i) {
+        const QSize scaledSize = geometries.at(i).size * m_dpr;
+        const QSize &cornerSize = geometries.at(i).cornerSize;
+        const QPoint &position = layers.at(i).position;
+        first.rx() = qMax(first.x(), position.x() + cornerSize.width() - 1);
+        first.ry() = qMax(first.y(), position.y() + cornerSize.height() - 1);
+        last.rx() = qMin(last.x(), position.x() + scaledSize.width() - cornerSize.width());
+        last.ry() = qMin(last.y(), position.y() + scaledSize.height() - cornerSize.height());
+    }
+
+    QSize textureSize = canvasSize;
+    CanvasAxis columns;
+    CanvasAxis rows;
+    columns.length = qRound(canvasSize.width() * m_dpr);
+    rows.length = qRound(canvasSize.height() * m_dpr);
+    if (collapse) {
+        columns = collapseCanvasAxis(canvasSize.width(), first.x(), last.x(), m_dpr, &textureSize.rwidth());
+        rows = collapseCanvasAxis(canvasSize.height(), first.y(), last.y(), m_dpr, &textureSize.rheight());
+    }
+
+    Tiles tiles;
+    tiles.boxRect = boxRect.adjusted(0, 0, textureSize.width() - canvasSize.width(), textureSize.height() - canvasSize.height());
+
+    QByteArray cacheKey;
+    if (m_persistentCacheEnabled) {
+        QDataStream stream(&cacheKey, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << m_boxSize << m_borderRadius << m_dpr << static_cast<qint32>(m_backend);
+        stream << collapse << frameMargins << static_cast<qint32>(m_shadows.count());
+        for (const Shadow &shadow : qAsConst(m_shadows)) {
+            stream << shadow.offset << static_cast<qint32>(shadow.radius) << shadow.color.rgba();
+        }
+
+        tiles.image = ShadowTextureCache::load(cacheKey);
+        if (!tiles.image.isNull()) {
+            return tiles;
+        }
+    }
+
+    tiles.image = QImage(columns.length, rows.length, QImage::Format_ARGB32_Premultiplied);
+    tiles.image.setDevicePixelRatio(m_dpr);
+    tiles.image.fill(Qt::transparent);
+
+    // Layers are independent until they are composited, so big ones are
+    // rendered concurrently.
+    const auto renderLayer = [&](int index) {
+        layers[index].mask = renderShadowMask(m_boxSize, m_borderRadius, m_shadows.at(index).radius, m_dpr, m_backend);
+    };
+
+    if (canvasSize.width() * canvasSize.height() * m_dpr * m_dpr < s_parallelPixelThreshold) {
+        for (int i = 0; i < layers.count(); ++i) {
+            renderLayer(i);
+        }
+    } else {
+        WorkerPool::run(layers.count(), renderLayer);
+    }
+
+    compositeShadowLayers(tiles.image, layers, columns, rows);
+
+    if (m_persistentCacheEnabled) {
+        ShadowTextureCache::store(cacheKey, tiles.image);
     }
-    painter.end();
 
-    return canvas;
+    return tiles;
 }
 
 QSize BoxShadowRenderer::calculateMinimumBoxSize(int radius)
@@ -24,7 +24,9 @@
 // Qt
 #include <QColor>
 #include <QImage>
+#include <QMargins>
 #include <QPoint>
+#include <QRect>
 #include <QSize>
 
 namespace Lightly
@@ -35,6 +37,16 @@ class LIGHTLYCOMMON_EXPORT BoxShadowRenderer
 public:
     // Compiler generated constructors & destructor are fine.
 
+    /**
+     * The way shadows are generated.
+     **/
+    enum class Backend {
+        /// Rasterize the box and blur it with three box filters.
+        BoxBlur,
+        /// Compute the Gaussian-blurred coverage of the box in closed form.
+        Analytic
+    };
+
     /**
      * Set the size of the box.
      * @param size The size of the box.
@@ -53,6 +65,29 @@ public:
      **/
     void setDevicePixelRatio(qreal dpr);
 
+    /**
+     * Set the backend used to generate the shadow.
+     *
+     * The analytic backend needs neither rasterization nor blur passes. It
+     * matches the box blur up to the difference between a Gaussian and the
+     * three box filters approximating it.
+     *
+     * @param backend The backend, Backend::BoxBlur by default.
+     **/
+    void setBackend(Backend backend);
+
+    /**
+     * Set whether the shadow texture goes through the on-disk cache.
+     *
+     * When enabled, render() first looks for a texture rendered with the
+     * exact same parameters by any process, and stores the texture it renders
+     * otherwise. Meant for the few shadows every application and KWin render
+     * on startup, such as window, menu and tooltip shadows.
+     *
+     * @param enabled Whether the on-disk cache is used, false by default.
+     **/
+    void setPersistentCacheEnabled(bool enabled);
+
     /**
      * Add a shadow.
      * @param offset The offset of the shadow.
@@ -61,11 +96,38 @@ public:
      **/
     void addShadow(const QPoint &offset, int radius, const QColor &color);
 
+    /**
+     * A shadow texture laid out as a nine-patch.
+     *
+     * The center pixel of the texture, in logical pixels, is the middle tile;
+     * the row and the column through it are the edge tiles.
+     **/
+    struct Tiles {
+        QImage image;  ///< the texture, with the middle tile at its center
+        QRect boxRect; ///< the box in the texture, in logical pixels
+    };
+
     /**
      * Render the shadow.
      **/
     QImage render() const;
 
+    /**
+     * Render the shadow as a nine-patch.
+     *
+     * The texture is the one render() returns with the run of equal rows and
+     * columns in its middle collapsed to a single logical pixel, so only the
+     * corners and the edge profiles are composited. Stretching the middle row
+     * and column gives back the full texture. Around a box of the minimum
+     * size, the full texture has a single pixel between its corners already,
+     * and is returned as is.
+     *
+     * @param frameMargins How far past the box a frame with the border radius
+     * of the box, painted over the texture afterwards, goes. The rounded
+     * corners of the frame are kept whole.
+     **/
+    Tiles renderTiles(const QMargins &frameMargins = QMargins()) const;
+
     /**
      * Calculate the minimum size of the box.
      *
@@ -89,9 +151,13 @@ public:
     static QSize calculateMinimumShadowTextureSize(const QSize &boxSize, int radius, const QPoint &offset);
 
 private:
+    Tiles renderTexture(bool collapse, const QMargins &frameMargins) const;
+
     QSize m_boxSize;
     qreal m_borderRadius = 0.0;
     qreal m_dpr = 1.0;
+    Backend m_backend = Backend::BoxBlur;
+    bool m_persistentCacheEnabled = false;
 
     struct Shadow {
         QPoint offset;
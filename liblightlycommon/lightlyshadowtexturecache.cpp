@@ -0,0 +1,219 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyshadowtexturecache.h"
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+
+namespace Lightly
+{
+
+static const char s_magic[8] = { 'L', 'S', 'H', 'A', 'D', 'O', 'W', '\0' };
+
+/**
+ * Bump whenever the file layout, the way textures are rendered, or the way
+ * their keys are built changes.
+ **/
+static const quint32 s_version = 2;
+
+/**
+ * Limits of the cache directory. Past either of them, the least recently
+ * modified entries are removed when a texture is stored.
+ **/
+static const int s_maxEntryCount = 64;
+static const qint64 s_maxTotalSize = 16 * 1024 * 1024;
+
+struct CacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 keySize;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    quint32 reserved;
+    double devicePixelRatio;
+};
+
+/**
+ * Offset of the pixels in a cache file. Pixels are aligned to 16 bytes so
+ * they can be used in place once the file is mapped.
+ **/
+static inline qint64 pixelOffset(quint32 keySize)
+{
+    return (qint64(sizeof(CacheHeader)) + keySize + 15) & ~qint64(15);
+}
+
+static QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/lightly/shadows");
+}
+
+static QString cacheFilePath(const QByteArray &key)
+{
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+    return cacheDirectory() + QLatin1Char('/') + QString::fromLatin1(hash);
+}
+
+/**
+ * Whether a cache file was written with the current file layout.
+ **/
+static bool hasCurrentVersion(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    CacheHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))) {
+        return false;
+    }
+
+    return std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0
+        && header.version == s_version;
+}
+
+/**
+ * Remove entries of an older version, then the least recently modified
+ * entries past the limits of the cache directory.
+ **/
+static void pruneCacheDirectory()
+{
+    // Entries are named after the hex SHA-1 of their key. Anything else, such as
+    // the temporary file of a texture being stored by another process, is left alone.
+    const int entryNameLength = 40;
+
+    // Most recently modified first.
+    const QFileInfoList entries = QDir(cacheDirectory()).entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+
+    int entryCount = 0;
+    qint64 totalSize = 0;
+    for (const QFileInfo &entry : entries) {
+        if (entry.fileName().size() != entryNameLength) {
+            continue;
+        }
+
+        if (!hasCurrentVersion(entry.filePath())) {
+            QFile::remove(entry.filePath());
+            continue;
+        }
+
+        ++entryCount;
+        totalSize += entry.size();
+        if (entryCount > s_maxEntryCount || totalSize > s_maxTotalSize) {
+            QFile::remove(entry.filePath());
+        }
+    }
+}
+
+static void unmapCacheFile(void *info)
+{
+    // Closing the file also unmaps it.
+    delete static_cast<QFile *>(info);
+}
+
+QImage ShadowTextureCache::load(const QByteArray &key)
+{
+    QScopedPointer<QFile> file(new QFile(cacheFilePath(key)));
+    if (!file->open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    const qint64 fileSize = file->size();
+    if (fileSize < qint64(sizeof(CacheHeader))) {
+        return {};
+    }
+
+    const uchar *data = file->map(0, fileSize);
+    if (!data) {
+        return {};
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // Anything unexpected means the entry is stale or corrupt, it will be
+    // overwritten once the texture is rendered again. The size of the file is
+    // checked against the header before the key or the pixels are touched.
+    if (std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0
+            || header.version != s_version
+            || header.keySize != quint32(key.size())
+            || header.width <= 0 || header.height <= 0
+            || qint64(header.bytesPerLine) < qint64(header.width) * 4
+            || header.devicePixelRatio <= 0
+            || pixelOffset(header.keySize) + qint64(header.height) * header.bytesPerLine != fileSize
+            || std::memcmp(data + sizeof(header), key.constData(), key.size()) != 0) {
+        return {};
+    }
+
+    const uchar *pixels = data + pixelOffset(header.keySize);
+
+    // The image does not own the pixels, it is read-only and detaches if painted on.
+    QImage image(pixels, header.width, header.height, header.bytesPerLine,
+                 QImage::Format_ARGB32_Premultiplied, unmapCacheFile, file.take());
+    image.setDevicePixelRatio(header.devicePixelRatio);
+    return image;
+}
+
+void ShadowTextureCache::store(const QByteArray &key, const QImage &image)
+{
+    if (image.isNull() || image.format() != QImage::Format_ARGB32_Premultiplied) {
+        return;
+    }
+
+    const QString path = cacheFilePath(key);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return;
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.keySize = key.size();
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+    header.devicePixelRatio = image.devicePixelRatio();
+
+    const QByteArray padding(pixelOffset(header.keySize) - qint64(sizeof(header)) - key.size(), '\0');
+
+    // Written to a temporary file and renamed, so other processes never see a partial entry.
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(key);
+    file.write(padding);
+    file.write(reinterpret_cast<const char *>(image.constBits()), qint64(image.height()) * image.bytesPerLine());
+    if (file.commit()) {
+        pruneCacheDirectory();
+    }
+}
+
+} // namespace Lightly
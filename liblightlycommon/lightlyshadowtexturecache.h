@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "lightlycommon_export.h"
+
+// Qt
+#include <QByteArray>
+#include <QImage>
+
+namespace Lightly
+{
+
+/**
+ * On-disk cache of shadow textures, shared by all processes of a user.
+ *
+ * Every texture is stored in its own file under $XDG_CACHE_HOME/lightly/shadows,
+ * made of a small header, the key the texture was rendered with, and the raw
+ * premultiplied pixels. Files are memory-mapped when loaded and replaced
+ * atomically when stored. Storing a texture also removes entries of older
+ * versions, and the least recently modified ones past a size limit.
+ **/
+class LIGHTLYCOMMON_EXPORT ShadowTextureCache
+{
+public:
+    /**
+     * Load a shadow texture.
+     *
+     * @param key The full set of parameters the texture was rendered with.
+     * @returns The texture, or a null image if there is no valid cache entry.
+     **/
+    static QImage load(const QByteArray &key);
+
+    /**
+     * Store a shadow texture, replacing any previous entry with the same key.
+     *
+     * @param key The full set of parameters the texture was rendered with.
+     * @param image The texture, in ARGB32_Premultiplied format.
+     **/
+    static void store(const QByteArray &key, const QImage &image);
+};
+
+} // namespace Lightly
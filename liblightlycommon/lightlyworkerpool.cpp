@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "lightlyworkerpool.h"
+
+// Qt
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+namespace Lightly
+{
+
+namespace
+{
+
+//* upper bound for the number of worker threads, the calling thread not included
+const int s_maxWorkerCount = 3;
+
+//* how long idle worker threads are kept around, in milliseconds
+const int s_workerExpiryTimeout = 5000;
+
+class ShadowThreadPool : public QThreadPool
+{
+public:
+    ShadowThreadPool()
+    {
+        setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, s_maxWorkerCount));
+        setExpiryTimeout(s_workerExpiryTimeout);
+    }
+};
+
+Q_GLOBAL_STATIC(ShadowThreadPool, s_threadPool)
+
+class Job : public QRunnable
+{
+public:
+    Job(const std::function<void(int)> &job, int index, QSemaphore *done)
+        : m_job(job)
+        , m_index(index)
+        , m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        m_job(m_index);
+        m_done->release();
+    }
+
+private:
+    const std::function<void(int)> &m_job;
+    const int m_index;
+    QSemaphore *m_done;
+};
+
+}
+
+int WorkerPool::concurrency()
+{
+    return s_threadPool()->maxThreadCount() + 1;
+}
+
+void WorkerPool::run(int count, const std::function<void(int)> &job)
+{
+    if (count <= 1) {
+        if (count == 1) {
+            job(0);
+        }
+        return;
+    }
+
+    QSemaphore done;
+    int started = 0;
+
+    // The first job is kept for the calling thread, so that it has
+    // something to do while the workers are busy.
+    for (int i = 1; i < count; ++i) {
+        Job *runnable = new Job(job, i, &done);
+        if (s_threadPool()->tryStart(runnable)) {
+            ++started;
+        } else {
+            delete runnable;
+            job(i);
+        }
+    }
+
+    job(0);
+    done.acquire(started);
+}
+
+} // namespace Lightly
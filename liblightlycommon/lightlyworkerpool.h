@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// Qt
+#include <QtGlobal>
+
+// STL
+#include <functional>
+
+namespace Lightly
+{
+
+/**
+ * Small pool of worker threads used to render shadow textures.
+ *
+ * Work is handed to the pool only if it has idle threads, everything else
+ * runs on the calling thread. Nested calls therefore never wait on each
+ * other and cannot dead-lock.
+ **/
+class WorkerPool
+{
+public:
+    /**
+     * The maximum number of jobs that may run at the same time, including
+     * the calling thread.
+     **/
+    static int concurrency();
+
+    /**
+     * Run a batch of independent jobs.
+     *
+     * @param count The number of jobs.
+     * @param job Called once for every index in [0, count).
+     * @returns When all jobs are done.
+     **/
+    static void run(int count, const std::function<void(int)> &job);
+};
+
+} // namespace Lightly